@@ -0,0 +1,182 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+/* Buffered output shared by the programs that print a lot of small pieces
+(n_queens, powerset, permutations, rip, filter). Header only: a program just
+includes it, and is still compiled on its own (gcc n_queens.c).
+
+	t_writer	out; // global: the buffer is inside
+
+	writer_init(&out, 1);
+	writer_int(&out, 42);
+	writer_char(&out, '\n');
+	writer_flush(&out); // before returning from main()
+
+printf("%d") parses its format and takes the stdio lock for every call, puts()
+takes the lock too, and write() of one byte is a system call per byte. Here
+the bytes are appended to a WRITER_BUFFER_SIZE buffer with a plain store or a
+memcpy(), and write() is only called when the buffer is full or on
+writer_flush(). Numbers are converted two digits at a time with a table of the
+100 pairs "00" to "99": half the divisions of the usual digit loop, and no
+format to parse. A write() error is remembered: the following output is
+dropped and writer_flush() returns -1. Nothing is written by itself at exit,
+so writer_flush() must be called (stdio output of the same program is
+buffered separately: do not mix both on one fd without flushing in between). */
+
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifndef WRITER_BUFFER_SIZE
+#define WRITER_BUFFER_SIZE (256 * 1024) // bytes collected before one write()
+#endif
+#define WRITER_NUMBER_MAX 20 // digits of the largest unsigned long long
+
+typedef struct s_writer
+{
+	int		fd;
+	size_t	len; // bytes waiting in buf
+	int		error; // a write() failed
+	char	buf[WRITER_BUFFER_SIZE];
+}	t_writer;
+
+static const char	g_digit_pairs[201] =
+	"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+	"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static inline void	writer_init(t_writer *w, int fd)
+{
+	w->fd = fd;
+	w->len = 0;
+	w->error = 0;
+}
+
+// write() len bytes at s, however many calls it takes; -1 on error
+static inline int	writer_write_all(int fd, const char *s, size_t len)
+{
+	ssize_t	ret;
+
+	while (len > 0)
+	{
+		ret = write(fd, s, len);
+		if (ret < 0 && errno == EINTR)
+			continue ;
+		if (ret < 0)
+			return -1;
+		s += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+// write the buffered bytes out; 0 if everything written so far went out
+static inline int	writer_flush(t_writer *w)
+{
+	if (w->len > 0 && !w->error && writer_write_all(w->fd, w->buf, w->len) != 0)
+		w->error = 1;
+	w->len = 0;
+	return w->error ? -1 : 0;
+}
+
+static inline void	writer_char(t_writer *w, char c)
+{
+	if (w->len == WRITER_BUFFER_SIZE)
+		writer_flush(w);
+	w->buf[w->len++] = c;
+}
+
+// append len bytes; a block larger than the buffer is written as it is
+static inline void	writer_bytes(t_writer *w, const char *s, size_t len)
+{
+	if (len > WRITER_BUFFER_SIZE - w->len)
+	{
+		writer_flush(w);
+		if (len >= WRITER_BUFFER_SIZE)
+		{
+			if (!w->error && writer_write_all(w->fd, s, len) != 0)
+				w->error = 1;
+			return ;
+		}
+	}
+	memcpy(w->buf + w->len, s, len);
+	w->len += len;
+}
+
+// append count copies of c (e.g. a run of '*'), one memset() per buffer
+static inline void	writer_fill(t_writer *w, char c, size_t count)
+{
+	size_t	n;
+
+	while (count > 0)
+	{
+		if (w->len == WRITER_BUFFER_SIZE)
+			writer_flush(w);
+		n = WRITER_BUFFER_SIZE - w->len;
+		if (n > count)
+			n = count;
+		memset(w->buf + w->len, c, n);
+		w->len += n;
+		count -= n;
+	}
+}
+
+static inline void	writer_str(t_writer *w, const char *s)
+{
+	writer_bytes(w, s, strlen(s));
+}
+
+// the number of decimal digits of n (comparisons only, no division)
+static inline int	writer_digits(unsigned long long n)
+{
+	unsigned long long	pow = 10;
+	int					digits = 1;
+
+	while (digits < WRITER_NUMBER_MAX && n >= pow)
+	{
+		digits++;
+		pow *= 10; // overflows only once digits == WRITER_NUMBER_MAX
+	}
+	return digits;
+}
+
+/* n in decimal, written straight into the buffer: the length is known first,
+so the digits are stored from the last one back, two at a time */
+static inline void	writer_uint(t_writer *w, unsigned long long n)
+{
+	int		digits = writer_digits(n);
+	char	*p;
+
+	if (WRITER_BUFFER_SIZE - w->len < WRITER_NUMBER_MAX)
+		writer_flush(w);
+	p = w->buf + w->len + digits;
+	while (n >= 100)
+	{
+		const char *pair = g_digit_pairs + 2 * (n % 100);
+		n /= 100;
+		*--p = pair[1];
+		*--p = pair[0];
+	}
+	if (n >= 10)
+	{
+		*--p = g_digit_pairs[2 * n + 1];
+		*--p = g_digit_pairs[2 * n];
+	}
+	else
+		*--p = '0' + n;
+	w->len += digits;
+}
+
+static inline void	writer_int(t_writer *w, long long n)
+{
+	if (n < 0)
+	{
+		writer_char(w, '-');
+		writer_uint(w, 0 - (unsigned long long)n); // LLONG_MIN too
+	}
+	else
+		writer_uint(w, n);
+}
+
+#endif
@@ -2,6 +2,11 @@
 #include <string.h>  // For strlen
 #include <unistd.h>  // For read, write, STDIN_FILENO, STDOUT_FILENO
 #include <stdlib.h>  // For malloc, free
+#include "../../common/writer.h" // For t_writer: buffered output
+
+// All output goes through this buffer and leaves in a few large write() calls,
+// instead of one write() system call per byte.
+t_writer out;
 
 // Define the maximum buffer size. We add +1 for the null terminator,
 // ensuring we can store up to 10k bytes of actual content safely.
@@ -81,6 +86,7 @@ int main(int ac, char **av) {
 
     // --- 4. Second Loop: Process 'buff' and write to stdout ---
     int process_idx = 0; // Index for iterating through 'buff' for processing and output.
+    writer_init(&out, STDOUT_FILENO);
     while (buff[process_idx] != '\0') { // Loop until the null terminator is reached (end of valid input).
         // Check for a match of 'search_str' starting at 'buff[process_idx]':
         // 1. Ensure there are enough characters remaining in the *valid part* of 'buff'
@@ -90,21 +96,23 @@ int main(int ac, char **av) {
             ft_strncmp(&buff[process_idx], search_str, search_len) == 1)
         {
             // If a match is found:
-            // Write 'search_len' number of asterisks to standard output.
-            for (int y = 0; y < search_len; y++) {
-                write(STDOUT_FILENO, "*", 1); // write one '*' at a time.
-            }
+            // Write 'search_len' number of asterisks to standard output,
+            // appended to the buffer as one run (a single memset).
+            writer_fill(&out, '*', search_len);
             // Advance the processing index past the matched string.
             process_idx += search_len;
         } else {
             // If no match at the current position:
             // Write the current character from 'buff' to standard output.
-            write(STDOUT_FILENO, &buff[process_idx], 1); // write the character itself.
+            writer_char(&out, buff[process_idx]); // append the character itself.
             // Advance the processing index by one character.
             process_idx++;
         }
     }
 
+    // Write out what is still in the buffer.
+    writer_flush(&out);
+
     // --- 5. Memory Cleanup ---
     free(buff); // Free the dynamically allocated memory before exiting.
 
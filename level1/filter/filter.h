@@ -0,0 +1,55 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+// Shared declarations for the filter variants that are split over several files
+// (filter.c and my_filter.c are the single-file exam solutions).
+
+#include <stddef.h>
+#include <sys/uio.h>
+#include "../../common/writer.h" // t_writer: the buffered output of every variant
+
+#ifndef STREAM_BLOCK_SIZE
+#define STREAM_BLOCK_SIZE (256 * 1024) // bytes asked from read() at a time
+#endif
+
+#define SHORT_PATTERN_MAX 32 // longer search strings use Horspool
+
+enum e_match_kind
+{
+	MATCH_BYTE,
+	MATCH_SHORT,
+	MATCH_HORSPOOL
+};
+
+// a search string prepared once for fast repeated searches (see matcher.c)
+typedef struct s_matcher
+{
+	const unsigned char	*pat;
+	size_t				len;
+	enum e_match_kind	kind;
+	size_t				shift[256]; // Horspool bad-character shifts
+}	t_matcher;
+
+#define STARS_SIZE 4096 // masked runs given to writev() point into this buffer
+#define IOV_BATCH 1024 // iovecs per writev() call (IOV_MAX on Linux)
+
+// output spans that are not copied: a batch of iovecs waiting for writev()
+typedef struct s_iov_out
+{
+	int				fd;
+	int				count;
+	struct iovec	iov[IOV_BATCH];
+}	t_iov_out;
+
+/* matcher.c */
+void		matcher_init(t_matcher *m, const char *search, size_t search_len);
+const char	*matcher_find(const t_matcher *m, const char *hay, size_t hay_len);
+
+/* stream.c */
+void	iov_init(t_iov_out *out, int fd);
+int		iov_add(t_iov_out *out, const char *s, size_t len);
+int		iov_add_stars(t_iov_out *out, size_t count);
+int		iov_flush(t_iov_out *out);
+int		filter_stream(int in_fd, int out_fd, const char *search, size_t search_len);
+
+#endif
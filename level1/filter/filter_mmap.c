@@ -0,0 +1,271 @@
+/* Zero-copy version of filter, for large inputs with few matches.
+
+Even the streaming version (stream.c) copies every byte twice: from the kernel
+into our buffer with read(), and back into the kernel with write(). Here the
+input is looked at without being copied whenever the kernel allows it:
+- stdin is a regular file: the file is mmap()ed and searched in place. The
+output is a list of iovecs pointing into the mapping for the unchanged spans,
+and into one shared buffer of '*' for the masked runs, sent with writev().
+- stdin is a pipe (Linux): tee() duplicates the pending data into a private
+pipe without consuming it, and we read that copy to search it. If the data
+holds no match, it is moved from stdin to stdout with splice(), which never
+copies it to user space, so a clean multi-GB stream costs about as much as
+cat. Only the chunks that do contain a match (or the start of one at their
+very end) are read and masked the normal way.
+- anything else (tty, socket, ...): the streaming engine of filter_stream.c.
+
+Compile with: gcc filter_mmap.c stream.c matcher.c */
+
+#define _GNU_SOURCE // tee(), splice()
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "filter.h"
+
+#define PIPE_CHUNK (64 * 1024) // at most one pipe buffer is looked at at a time
+
+// regular file: search the mapping in place, output spans of the mapping
+int filter_mapped(int in_fd, off_t size, const t_matcher *m)
+{
+	off_t start = lseek(in_fd, 0, SEEK_CUR); // respect what was already consumed
+	if (start < 0 || start >= size)
+		return 0;
+	char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	madvise(map, size, MADV_SEQUENTIAL);
+	t_iov_out out;
+	iov_init(&out, STDOUT_FILENO);
+	const char *p = map + start;
+	const char *end = map + size;
+	int ret = 0;
+	while (p < end && ret == 0)
+	{
+		const char *match = matcher_find(m, p, end - p);
+		if (!match)
+		{
+			ret = iov_add(&out, p, end - p);
+			break ;
+		}
+		if (iov_add(&out, p, match - p) != 0 || iov_add_stars(&out, m->len) != 0)
+			ret = -1;
+		p = match + m->len;
+	}
+	if (ret == 0)
+		ret = iov_flush(&out);
+	lseek(in_fd, size, SEEK_SET);
+	int saved_errno = errno;
+	munmap(map, size);
+	errno = saved_errno;
+	return ret;
+}
+
+#ifdef __linux__
+
+// length of the longest end of s[0..len) that is the start of the pattern
+// (a match could begin there and finish in data that has not arrived yet)
+size_t pattern_prefix_tail(const t_matcher *m, const char *s, size_t len)
+{
+	size_t k = m->len - 1 < len ? m->len - 1 : len;
+	while (k > 0 && memcmp(s + len - k, m->pat, k) != 0)
+		k--;
+	return k;
+}
+
+// read exactly len bytes (less only at EOF)
+ssize_t read_full(int fd, char *buf, size_t len)
+{
+	size_t done = 0;
+	while (done < len)
+	{
+		ssize_t bytes = read(fd, buf + done, len - done);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes < 0)
+			return -1;
+		if (bytes == 0)
+			break ;
+		done += bytes;
+	}
+	return done;
+}
+
+// move len bytes from stdin to stdout inside the kernel
+int splice_all(size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t moved = splice(STDIN_FILENO, NULL, STDOUT_FILENO, NULL, len, SPLICE_F_MOVE);
+		if (moved < 0 && errno == EINTR)
+			continue ;
+		if (moved <= 0)
+			return -1;
+		len -= moved;
+	}
+	return 0;
+}
+
+/* Mask buf[0..avail) like stream.c does, and keep in buf the bytes that are
+still undecided; returns how many are kept. Unlike stream.c, only the bytes
+that could really start a match are kept (often none), so that the next chunk
+can go back to the zero-copy path. */
+size_t mask_chunk(const t_matcher *m, t_writer *out, char *buf, size_t avail, int eof)
+{
+	size_t i = 0;
+	size_t span = 0;
+	while (i + m->len <= avail)
+	{
+		const char *match = matcher_find(m, buf + i, avail - i);
+		if (!match)
+		{
+			i = avail - m->len + 1;
+			break ;
+		}
+		i = match - buf;
+		writer_bytes(out, buf + span, i - span);
+		writer_fill(out, '*', m->len);
+		i += m->len;
+		span = i;
+	}
+	if (eof)
+		i = avail;
+	i = avail - pattern_prefix_tail(m, buf + i, avail - i);
+	writer_bytes(out, buf + span, i - span);
+	memmove(buf, buf + i, avail - i);
+	return avail - i;
+}
+
+// pipe to anything; sets *unsupported (and touches nothing) if tee() is not
+// available, so that the caller can fall back to filter_stream()
+int filter_pipe(const t_matcher *m, int *unsupported)
+{
+	int peek_pipe[2];
+	t_writer *out = malloc(sizeof(t_writer));
+	// the carried-over bytes plus one pipe buffer
+	size_t cap = PIPE_CHUNK + m->len;
+	char *buf = malloc(cap);
+	char *peek = malloc(PIPE_CHUNK);
+	if (!buf || !peek || !out)
+	{
+		free(buf);
+		free(peek);
+		free(out);
+		return -1;
+	}
+	writer_init(out, STDOUT_FILENO);
+	if (pipe(peek_pipe) != 0)
+	{
+		free(out);
+		free(buf);
+		free(peek);
+		return -1;
+	}
+	size_t carry = 0; // undecided bytes at the front of buf
+	int can_splice = 1;
+	int first = 1;
+	int ret = 0;
+	while (ret == 0)
+	{
+		if (carry == 0)
+		{
+			// look at the pending data without consuming it
+			ssize_t n = tee(STDIN_FILENO, peek_pipe[1], PIPE_CHUNK, 0);
+			if (n < 0 && errno == EINTR)
+				continue ;
+			if (n < 0 && errno == EINVAL && first)
+			{
+				*unsupported = 1; // nothing was consumed yet
+				break ;
+			}
+			first = 0;
+			if (n <= 0)
+			{
+				ret = n < 0 ? -1 : 0;
+				break ;
+			}
+			if (read_full(peek_pipe[0], peek, n) != n)
+			{
+				ret = -1;
+				break ;
+			}
+			size_t clean = n - pattern_prefix_tail(m, peek, n);
+			if (can_splice && clean > 0 && !matcher_find(m, peek, n))
+			{
+				// no match: move the clean part through the kernel, untouched
+				if (writer_flush(out) != 0)
+					ret = -1;
+				else if (splice_all(clean) != 0)
+				{
+					if (errno != EINVAL)
+						ret = -1;
+					can_splice = 0; // e.g. stdout is a tty: the next chunks are read
+				}
+				continue ;
+			}
+		}
+		// a match (or only the start of one): consume the data and mask it
+		ssize_t bytes = read(STDIN_FILENO, buf + carry, cap - carry);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes < 0)
+		{
+			ret = -1;
+			break ;
+		}
+		first = 0;
+		carry = mask_chunk(m, out, buf, carry + bytes, bytes == 0);
+		if (bytes == 0)
+			break ;
+	}
+	if (writer_flush(out) != 0)
+		ret = -1;
+	int saved_errno = errno;
+	close(peek_pipe[0]);
+	close(peek_pipe[1]);
+	free(out);
+	free(buf);
+	free(peek);
+	errno = saved_errno;
+	return ret;
+}
+
+#endif
+
+int main(int argc, char *argv[])
+{
+	struct stat st;
+	t_matcher m;
+	int ret;
+
+	// one and only one non-empty argument
+	if (argc != 2 || argv[1] == NULL || strlen(argv[1]) == 0)
+		return 1;
+	matcher_init(&m, argv[1], strlen(argv[1]));
+	if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode))
+		ret = filter_mapped(STDIN_FILENO, st.st_size, &m);
+	else
+	{
+		int unsupported = 1;
+#ifdef __linux__
+		if (fstat(STDIN_FILENO, &st) == 0 && S_ISFIFO(st.st_mode))
+		{
+			unsupported = 0;
+			ret = filter_pipe(&m, &unsupported);
+		}
+#endif
+		if (unsupported)
+			ret = filter_stream(STDIN_FILENO, STDOUT_FILENO, argv[1], strlen(argv[1]));
+	}
+	if (ret != 0)
+	{
+		fprintf(stderr, "Error: ");
+		perror("");
+		return 1;
+	}
+	return 0;
+}
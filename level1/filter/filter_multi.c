@@ -0,0 +1,357 @@
+/* Multi-pattern filter: masks ALL the given terms in a single pass over stdin,
+instead of piping the input through one filter process per term.
+
+Usage:
+	./filter_multi term1 term2 ...
+	./filter_multi -f terms_file [term ...]     (one term per line)
+
+Compile with: gcc filter_multi.c stream.c matcher.c
+
+The terms are compiled into an Aho-Corasick automaton: a trie of all the terms,
+where a missing transition follows the "failure link" (the longest suffix of
+the text read so far that is still a prefix of some term). All those links are
+resolved in advance, so the automaton is a dense table:
+	next_state = delta[state][class_of[byte]]
+and the work per input byte is one table look-up, whatever the number of terms.
+The 256 byte values are first mapped to a few classes (every byte that appears
+in a term gets its own class, all the others share class 0), which keeps the
+table small.
+
+Matching rule: leftmost-longest, non-overlapping. Among the matches that start
+the earliest, the longest one is masked; then the search restarts right after
+it. With one term this is exactly what filter.c does. A candidate match can only
+be masked once no longer match starting at the same place (or earlier) can
+still show up: every future match starts at or after pos - depth[state], so as
+soon as the candidate starts before that point it is final. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include "filter.h"
+
+typedef struct s_automaton
+{
+	int		nclasses;
+	int		nstates;
+	int		capacity; // rows allocated in delta
+	int		class_of[256];
+	int		*delta; // nstates rows of nclasses entries
+	int		*fail;
+	int		*depth; // length of the string that leads to the state
+	int		*match_len; // longest term that ends in this state, 0 if none
+	size_t	max_len; // longest term
+}	t_automaton;
+
+typedef struct s_terms
+{
+	char	**items;
+	size_t	*lens;
+	size_t	count;
+	size_t	capacity;
+}	t_terms;
+
+int add_term(t_terms *terms, char *term, size_t len)
+{
+	if (len == 0) // empty terms (e.g. blank lines) would match everywhere
+		return 0;
+	if (terms->count == terms->capacity)
+	{
+		size_t new_capacity = terms->capacity ? terms->capacity * 2 : 16;
+		char **items = realloc(terms->items, sizeof(char *) * new_capacity);
+		if (!items)
+			return -1;
+		terms->items = items;
+		size_t *lens = realloc(terms->lens, sizeof(size_t) * new_capacity);
+		if (!lens)
+			return -1;
+		terms->lens = lens;
+		terms->capacity = new_capacity;
+	}
+	terms->items[terms->count] = term;
+	terms->lens[terms->count] = len;
+	terms->count++;
+	return 0;
+}
+
+// one term per line; the lines are kept in memory (they are pointed to by terms)
+int load_terms_file(t_terms *terms, const char *path, char ***lines, size_t *nlines)
+{
+	FILE *file = fopen(path, "r");
+	char *line = NULL;
+	size_t n = 0;
+	ssize_t len;
+	if (!file)
+		return -1;
+	while ((len = getline(&line, &n, file)) != -1)
+	{
+		if (len > 0 && line[len - 1] == '\n')
+			len--;
+		char **tmp = realloc(*lines, sizeof(char *) * (*nlines + 1));
+		if (!tmp)
+		{
+			free(line);
+			fclose(file);
+			return -1;
+		}
+		*lines = tmp;
+		(*lines)[(*nlines)++] = line; // freed by the caller from now on
+		if (add_term(terms, line, len) != 0)
+		{
+			fclose(file);
+			return -1;
+		}
+		line = NULL;
+		n = 0;
+	}
+	free(line);
+	int ret = ferror(file) ? -1 : 0;
+	fclose(file);
+	return ret;
+}
+
+// add an empty state (all transitions to the root for now) and return its number
+int new_state(t_automaton *ac)
+{
+	if (ac->nstates == ac->capacity)
+	{
+		int new_capacity = ac->capacity * 2;
+		int *delta = realloc(ac->delta, sizeof(int) * (size_t)new_capacity * ac->nclasses);
+		if (!delta)
+			return -1;
+		ac->delta = delta;
+		int *depth = realloc(ac->depth, sizeof(int) * new_capacity);
+		if (!depth)
+			return -1;
+		ac->depth = depth;
+		int *match_len = realloc(ac->match_len, sizeof(int) * new_capacity);
+		if (!match_len)
+			return -1;
+		ac->match_len = match_len;
+		ac->capacity = new_capacity;
+	}
+	int s = ac->nstates++;
+	memset(ac->delta + (size_t)s * ac->nclasses, 0, sizeof(int) * ac->nclasses);
+	ac->depth[s] = 0;
+	ac->match_len[s] = 0;
+	return s;
+}
+
+int build_automaton(t_automaton *ac, const t_terms *terms)
+{
+	// byte classes: one per byte used by the terms, class 0 for everything else
+	ac->nclasses = 1;
+	for (size_t t = 0; t < terms->count; t++)
+		for (size_t i = 0; i < terms->lens[t]; i++)
+		{
+			unsigned char c = terms->items[t][i];
+			if (ac->class_of[c] == 0)
+				ac->class_of[c] = ac->nclasses++;
+		}
+	ac->capacity = 64;
+	ac->delta = malloc(sizeof(int) * (size_t)ac->capacity * ac->nclasses);
+	ac->depth = malloc(sizeof(int) * ac->capacity);
+	ac->match_len = malloc(sizeof(int) * ac->capacity);
+	if (!ac->delta || !ac->depth || !ac->match_len || new_state(ac) != 0)
+		return -1;
+	// 1) the trie (state 0 is the root; 0 also means "no child yet")
+	for (size_t t = 0; t < terms->count; t++)
+	{
+		int s = 0;
+		for (size_t i = 0; i < terms->lens[t]; i++)
+		{
+			int *next = &ac->delta[(size_t)s * ac->nclasses + ac->class_of[(unsigned char)terms->items[t][i]]];
+			if (*next == 0)
+			{
+				int child = new_state(ac);
+				if (child < 0)
+					return -1;
+				// new_state() may have moved the table
+				next = &ac->delta[(size_t)s * ac->nclasses + ac->class_of[(unsigned char)terms->items[t][i]]];
+				*next = child;
+				ac->depth[child] = ac->depth[s] + 1;
+			}
+			s = *next;
+		}
+		ac->match_len[s] = terms->lens[t];
+		if (terms->lens[t] > ac->max_len)
+			ac->max_len = terms->lens[t];
+	}
+	// 2) failure links in breadth-first order, turning the trie into a full table
+	ac->fail = calloc(ac->nstates, sizeof(int));
+	int *queue = malloc(sizeof(int) * ac->nstates);
+	if (!ac->fail || !queue)
+	{
+		free(queue);
+		return -1;
+	}
+	int head = 0, tail = 0;
+	for (int c = 0; c < ac->nclasses; c++)
+		if (ac->delta[c] != 0)
+			queue[tail++] = ac->delta[c]; // depth 1: fail to the root
+	while (head < tail)
+	{
+		int s = queue[head++];
+		int *row = ac->delta + (size_t)s * ac->nclasses;
+		int *fail_row = ac->delta + (size_t)ac->fail[s] * ac->nclasses;
+		// a term ending here, or else the longest one ending in the fail state
+		if (ac->match_len[s] == 0)
+			ac->match_len[s] = ac->match_len[ac->fail[s]];
+		for (int c = 0; c < ac->nclasses; c++)
+		{
+			// rows are resolved when their state is dequeued, so a non-zero entry
+			// here is still a trie child (the root is never anybody's child)
+			if (row[c] != 0)
+			{
+				ac->fail[row[c]] = fail_row[c];
+				queue[tail++] = row[c];
+			}
+			else
+				row[c] = fail_row[c];
+		}
+	}
+	free(queue);
+	return 0;
+}
+
+void free_automaton(t_automaton *ac)
+{
+	free(ac->delta);
+	free(ac->fail);
+	free(ac->depth);
+	free(ac->match_len);
+}
+
+// stream in_fd to out_fd, masking the leftmost-longest matches of all the terms
+int filter_multi(const t_automaton *ac, int in_fd, int out_fd)
+{
+	t_writer *out = malloc(sizeof(t_writer));
+	size_t cap = STREAM_BLOCK_SIZE + ac->max_len;
+	char *buf = malloc(cap);
+	if (!buf || !out)
+	{
+		free(buf);
+		free(out);
+		return -1;
+	}
+	writer_init(out, out_fd);
+	size_t avail = 0; // bytes in buf
+	size_t pos = 0; // next byte to feed to the automaton
+	size_t emit = 0; // first byte not written yet
+	size_t best_start = 0, best_end = 0; // the current candidate match
+	int have = 0;
+	int state = 0;
+	int eof = 0;
+	int ret = 0;
+	while (1)
+	{
+		while (pos < avail)
+		{
+			state = ac->delta[(size_t)state * ac->nclasses + ac->class_of[(unsigned char)buf[pos]]];
+			pos++;
+			if (ac->match_len[state])
+			{
+				size_t start = pos - ac->match_len[state];
+				if (!have || start < best_start || (start == best_start && pos > best_end))
+				{
+					best_start = start;
+					best_end = pos;
+					have = 1;
+				}
+			}
+			// no future match can start at or before best_start: mask it
+			if (have && best_start < pos - ac->depth[state])
+			{
+				writer_bytes(out, buf + emit, best_start - emit);
+				writer_fill(out, '*', best_end - best_start);
+				emit = best_end;
+				pos = best_end; // non-overlapping: restart right after the match
+				state = 0;
+				have = 0;
+			}
+		}
+		if (eof)
+		{
+			if (have) // the input is over: the candidate is final
+			{
+				writer_bytes(out, buf + emit, best_start - emit);
+				writer_fill(out, '*', best_end - best_start);
+				emit = best_end;
+				pos = best_end;
+				state = 0;
+				have = 0;
+				continue ;
+			}
+			writer_bytes(out, buf + emit, avail - emit);
+			break ;
+		}
+		// write what is decided, keep the (at most max_len) bytes that are not:
+		// the candidate, and the text the current state stands for (a longer
+		// match starting before the candidate may still end later)
+		size_t keep = pos - ac->depth[state];
+		if (have && best_start < keep)
+			keep = best_start;
+		writer_bytes(out, buf + emit, keep - emit);
+		memmove(buf, buf + keep, avail - keep);
+		avail -= keep;
+		pos -= keep;
+		best_start -= keep;
+		best_end -= keep;
+		emit = 0;
+		ssize_t bytes = read(in_fd, buf + avail, cap - avail);
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue ;
+			ret = -1;
+			break ;
+		}
+		if (bytes == 0)
+			eof = 1;
+		avail += bytes;
+	}
+	if (writer_flush(out) != 0)
+		ret = -1;
+	int saved_errno = errno;
+	free(out);
+	free(buf);
+	errno = saved_errno;
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	t_terms terms = {NULL, NULL, 0, 0};
+	t_automaton ac;
+	char **lines = NULL; // lines of the terms file
+	size_t nlines = 0;
+	int ret = 0;
+
+	memset(&ac, 0, sizeof(ac));
+	for (int i = 1; i < argc && ret == 0; i++)
+	{
+		if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			ret = load_terms_file(&terms, argv[++i], &lines, &nlines);
+		else
+			ret = add_term(&terms, argv[i], strlen(argv[i]));
+	}
+	// like filter: there must be something to search for
+	if (ret == 0 && terms.count == 0)
+		ret = 1;
+	else if (ret == 0 && (build_automaton(&ac, &terms) != 0
+			|| filter_multi(&ac, STDIN_FILENO, STDOUT_FILENO) != 0))
+		ret = -1;
+	if (ret == -1)
+	{
+		fprintf(stderr, "Error: ");
+		perror("");
+	}
+	free_automaton(&ac);
+	for (size_t i = 0; i < nlines; i++)
+		free(lines[i]);
+	free(lines);
+	free(terms.items);
+	free(terms.lens);
+	return ret != 0;
+}
@@ -0,0 +1,321 @@
+/* Multi-threaded version of filter, for large regular files.
+
+Usage:
+	./filter_parallel [-j threads] search < file
+
+The file is mmap()ed and cut into chunks of PARALLEL_CHUNK_SIZE bytes. Each
+worker thread takes the next chunk and lists the matches that START in it,
+restarting right after each match like filter.c does. The search is allowed to
+read up to (search_len - 1) bytes past the end of the chunk, so a match that
+crosses the border is found by the chunk it starts in.
+
+Only one thing can go wrong: a worker does not know where the previous chunk's
+last match ends, and assumes nothing overlaps its first byte. When a match does
+run into the next chunk (resume > chunk start), the matches of that chunk which
+start inside it are dropped and the few positions before the list is valid
+again are searched by the main thread (see stitch()). After at most
+(search_len - 1) bytes the list is in sync with filter.c's result, because from
+there on both walks restart from the same place.
+
+The main thread writes the chunks in order: the output is a list of iovecs
+pointing into the mapping, and into a buffer of '*' for the masked runs (see
+the t_iov_out helpers in stream.c). A chunk that is finished before the ones in
+front of it waits in a bounded reorder queue: a worker only takes chunk c when
+c < written + 2 * threads, which bounds the number of match lists kept in
+memory whatever the speed of stdout. Other inputs (pipes, ttys) go through the
+streaming engine.
+
+Compile with: gcc -pthread filter_parallel.c stream.c matcher.c */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "filter.h"
+
+#ifndef PARALLEL_CHUNK_SIZE
+# define PARALLEL_CHUNK_SIZE (8 * 1024 * 1024)
+#endif
+#define MAX_THREADS 256
+#define QUEUE_PER_THREAD 2 // chunks a worker may run ahead of the writer
+
+typedef struct s_chunk
+{
+	size_t	start; // offsets in the mapping
+	size_t	end;
+	size_t	*matches; // starts of the matches, in order
+	size_t	count;
+	size_t	capacity;
+	int		done;
+	int		error;
+}	t_chunk;
+
+typedef struct s_job
+{
+	const char		*map;
+	size_t			size;
+	const t_matcher	*m;
+	t_chunk			*chunks;
+	size_t			nchunks;
+	size_t			next; // next chunk to hand out
+	size_t			written; // chunks already given to the output
+	size_t			window; // at most this many chunks in flight
+	int				stop;
+	pthread_mutex_t	lock;
+	pthread_cond_t	can_take; // signalled when the writer moves on
+	pthread_cond_t	finished; // signalled when a chunk is done
+}	t_job;
+
+int add_match(t_chunk *chunk, size_t pos)
+{
+	if (chunk->count == chunk->capacity)
+	{
+		size_t new_capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+		size_t *tmp = realloc(chunk->matches, sizeof(size_t) * new_capacity);
+		if (!tmp)
+			return -1;
+		chunk->matches = tmp;
+		chunk->capacity = new_capacity;
+	}
+	chunk->matches[chunk->count++] = pos;
+	return 0;
+}
+
+// first match starting in [from, to), reading at most search_len - 1 bytes past 'to'
+const char *find_from(const t_job *job, size_t from, size_t to)
+{
+	size_t limit = to + job->m->len - 1;
+	if (limit > job->size)
+		limit = job->size;
+	if (from >= limit)
+		return NULL;
+	const char *match = matcher_find(job->m, job->map + from, limit - from);
+	if (match && (size_t)(match - job->map) >= to)
+		return NULL;
+	return match;
+}
+
+// list the matches starting in the chunk, as if nothing ran into its first byte
+void scan_chunk(const t_job *job, t_chunk *chunk)
+{
+	size_t pos = chunk->start;
+	const char *match;
+	while ((match = find_from(job, pos, chunk->end)) != NULL)
+	{
+		pos = match - job->map;
+		if (add_match(chunk, pos) != 0)
+		{
+			chunk->error = 1;
+			return ;
+		}
+		pos += job->m->len;
+	}
+}
+
+void *worker(void *arg)
+{
+	t_job *job = arg;
+	while (1)
+	{
+		pthread_mutex_lock(&job->lock);
+		while (!job->stop && job->next < job->nchunks
+			&& job->next >= job->written + job->window)
+			pthread_cond_wait(&job->can_take, &job->lock);
+		if (job->stop || job->next >= job->nchunks)
+		{
+			pthread_mutex_unlock(&job->lock);
+			return NULL;
+		}
+		t_chunk *chunk = &job->chunks[job->next++];
+		pthread_mutex_unlock(&job->lock);
+		scan_chunk(job, chunk);
+		pthread_mutex_lock(&job->lock);
+		chunk->done = 1;
+		pthread_cond_signal(&job->finished);
+		pthread_mutex_unlock(&job->lock);
+	}
+}
+
+int emit_match(const t_job *job, t_iov_out *out, size_t *resume, size_t match)
+{
+	if (iov_add(out, job->map + *resume, match - *resume) != 0
+		|| iov_add_stars(out, job->m->len) != 0)
+		return -1;
+	*resume = match + job->m->len;
+	return 0;
+}
+
+/* Output one chunk; *resume is the first byte after the last masked run.
+If the previous chunk's last match ends inside this one, the worker's list is
+repaired first: let l be the last listed match before resume. The worker, after
+l, searched from l + len on, so there is no match it missed in
+[max(resume, l + len), next listed match): only [resume, l + len) (less than
+len bytes) must be searched again. Without any l, the worker searched from the
+chunk start, which is before resume: nothing to search again. */
+int stitch(const t_job *job, const t_chunk *chunk, t_iov_out *out, size_t *resume)
+{
+	size_t i = 0;
+	size_t checked = chunk->start; // the worker's list is valid from here on
+	while (*resume > chunk->start)
+	{
+		while (i < chunk->count && chunk->matches[i] < *resume)
+			checked = chunk->matches[i++] + job->m->len;
+		size_t to = i < chunk->count ? chunk->matches[i] : chunk->end;
+		if (checked < to)
+			to = checked;
+		const char *match = *resume < to ? find_from(job, *resume, to) : NULL;
+		if (!match)
+			break ; // in sync with the list
+		if (emit_match(job, out, resume, match - job->map) != 0)
+			return -1;
+	}
+	for (; i < chunk->count; i++)
+		if (emit_match(job, out, resume, chunk->matches[i]) != 0)
+			return -1;
+	if (*resume < chunk->end)
+	{
+		if (iov_add(out, job->map + *resume, chunk->end - *resume) != 0)
+			return -1;
+		*resume = chunk->end;
+	}
+	return 0;
+}
+
+// the writer: stitch and output the chunks in order, as they are finished
+int write_chunks(t_job *job)
+{
+	t_iov_out out;
+	iov_init(&out, STDOUT_FILENO);
+	size_t resume = job->chunks[0].start;
+	int ret = 0;
+	for (size_t c = 0; c < job->nchunks && ret == 0; c++)
+	{
+		t_chunk *chunk = &job->chunks[c];
+		pthread_mutex_lock(&job->lock);
+		while (!chunk->done)
+			pthread_cond_wait(&job->finished, &job->lock);
+		pthread_mutex_unlock(&job->lock);
+		if (chunk->error)
+		{
+			errno = ENOMEM;
+			ret = -1;
+		}
+		else
+			ret = stitch(job, chunk, &out, &resume);
+		free(chunk->matches);
+		chunk->matches = NULL;
+		pthread_mutex_lock(&job->lock);
+		job->written = c + 1;
+		if (ret != 0)
+			job->stop = 1;
+		pthread_cond_broadcast(&job->can_take);
+		pthread_mutex_unlock(&job->lock);
+	}
+	if (ret == 0)
+		ret = iov_flush(&out);
+	return ret;
+}
+
+int filter_parallel(int in_fd, off_t size, const t_matcher *m, int nthreads)
+{
+	off_t start = lseek(in_fd, 0, SEEK_CUR); // respect what was already consumed
+	if (start < 0 || start >= size)
+		return 0;
+	char *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, in_fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	t_job job;
+	pthread_t threads[MAX_THREADS];
+	job.map = map;
+	job.size = size;
+	job.m = m;
+	job.nchunks = (size - start + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE;
+	job.next = 0;
+	job.written = 0;
+	job.window = (size_t)nthreads * QUEUE_PER_THREAD;
+	job.stop = 0;
+	job.chunks = calloc(job.nchunks, sizeof(t_chunk));
+	if (!job.chunks)
+	{
+		munmap(map, size);
+		return -1;
+	}
+	for (size_t c = 0; c < job.nchunks; c++)
+	{
+		job.chunks[c].start = start + c * (size_t)PARALLEL_CHUNK_SIZE;
+		job.chunks[c].end = job.chunks[c].start + PARALLEL_CHUNK_SIZE;
+		if (job.chunks[c].end > (size_t)size)
+			job.chunks[c].end = size;
+	}
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.can_take, NULL);
+	pthread_cond_init(&job.finished, NULL);
+	// no more threads than chunks
+	if ((size_t)nthreads > job.nchunks)
+		nthreads = job.nchunks;
+	int started = 0;
+	while (started < nthreads
+		&& pthread_create(&threads[started], NULL, worker, &job) == 0)
+		started++;
+	int ret;
+	if (started == 0)
+	{
+		errno = EAGAIN;
+		ret = -1;
+	}
+	else
+		ret = write_chunks(&job);
+	int saved_errno = errno;
+	pthread_mutex_lock(&job.lock);
+	job.stop = 1;
+	pthread_cond_broadcast(&job.can_take);
+	pthread_mutex_unlock(&job.lock);
+	for (int i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+	for (size_t c = 0; c < job.nchunks; c++)
+		free(job.chunks[c].matches);
+	free(job.chunks);
+	pthread_mutex_destroy(&job.lock);
+	pthread_cond_destroy(&job.can_take);
+	pthread_cond_destroy(&job.finished);
+	lseek(in_fd, size, SEEK_SET);
+	munmap(map, size);
+	errno = saved_errno;
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	struct stat st;
+	t_matcher m;
+	int ret;
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	int arg = 1;
+
+	if (argc == 4 && strcmp(argv[1], "-j") == 0)
+	{
+		nthreads = atol(argv[2]);
+		arg = 3;
+	}
+	// one and only one non-empty search string
+	if (argc != arg + 1 || argv[arg] == NULL || strlen(argv[arg]) == 0 || nthreads <= 0)
+		return 1;
+	if (nthreads > MAX_THREADS)
+		nthreads = MAX_THREADS;
+	matcher_init(&m, argv[arg], strlen(argv[arg]));
+	if (fstat(STDIN_FILENO, &st) == 0 && S_ISREG(st.st_mode))
+		ret = filter_parallel(STDIN_FILENO, st.st_size, &m, nthreads);
+	else
+		ret = filter_stream(STDIN_FILENO, STDOUT_FILENO, argv[arg], strlen(argv[arg]));
+	if (ret != 0)
+	{
+		fprintf(stderr, "Error: ");
+		perror("");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,1465 @@
+/* Regex version of filter: masks the matches of a regular expression instead
+of a fixed string, in one streaming pass over stdin.
+
+Usage:
+	./filter_regex [--no-cache] regex
+
+Compile with: gcc filter_regex.c stream.c matcher.c
+
+Supported syntax (bytes, no Unicode):
+	abc          literal bytes (escape . [ ] ( ) | * + ? { \ with a backslash)
+	.            any byte except '\n'
+	[a-z_]       class, [^...] for the complement, ']' first is a literal
+	\d \w \s     digits, word bytes [A-Za-z0-9_], white space (\D \W \S negated)
+	\n \t \r     the usual control characters
+	x* x+ x?     repetition
+	x{m} x{m,} x{m,n}
+	a|b  (...)   alternation and grouping
+For example: './filter_regex "[0-9]{4}( ?[0-9]{4}){3}"' masks card numbers.
+
+The regex goes through the classic pipeline:
+1) it is parsed into a syntax tree,
+2) the tree is turned into a Thompson NFA (x{2,4} becomes xxx?x?),
+3) subset construction turns the NFA into a DFA. The transitions are not
+indexed by byte but by byte CLASS: two bytes that no part of the regex tells
+apart (e.g. all the letters of [a-z]) share a class, so a row of the table has
+a few entries instead of 256,
+4) Moore's algorithm merges the equivalent DFA states (the smallest DFA),
+5) the DFA is saved in a cache file named after a hash of the regex, so that
+steps 1 to 4 are only run the first time a regex is used: in $XDG_CACHE_HOME
+(or ~/.cache) /filter_regex/<hash>.dfa, the directories being created when
+missing. The regex is stored in the file too, so a hash collision is detected
+and just means a cache miss.
+
+Matching rule: leftmost-longest, non-overlapping, like filter_multi.c. The DFA
+is anchored, and each byte is read once: it is fed to the runs of the DFA from
+every candidate start at the same time. Runs that reach the same DFA state
+have the same future, so they join one group and only the group is stepped:
+there are never more groups than DFA states, whatever the input. A start keeps
+the longest accepting position of its own run and of the groups it joined
+(union-find links, shortened when they are followed). The starts are decided
+in order: once the group of the oldest one stops (dead state), its longest
+match is masked and the next start to decide is the end of the match, or,
+without a match, the next byte. Candidate starts are filtered with the set of
+bytes that can begin a match. Empty matches (e.g. of "a*") are never masked.
+
+The bytes from the oldest undecided start on stay in memory (with 16 bytes of
+run per byte). A group may never stop: "a*" on "aaaa..." or "[^x]*y" on input
+without 'y'. So once a start is still undecided REGEX_MATCH_MAX bytes later,
+its group is stopped there: its longest match so far is masked, or none.
+Matches are therefore at most REGEX_MATCH_MAX bytes long, and the memory used
+stays below 2 * REGEX_MATCH_MAX * 17 bytes (34 MB). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "filter.h"
+
+#define MAX_DEPTH 256 // nested groups
+#define REPEAT_MAX 1000 // largest m or n in x{m,n}
+#define MAX_NFA_STATES 100000
+#define MAX_DFA_STATES 20000
+#define CACHE_MAGIC "FRDFA01"
+#ifndef REGEX_MATCH_MAX
+#define REGEX_MATCH_MAX (1024 * 1024) // longest match (below 1 << 29)
+#endif
+
+typedef struct s_byteset
+{
+	unsigned char	bits[32];
+}	t_byteset;
+
+/* -------------------------------- parser -------------------------------- */
+
+enum e_node_type
+{
+	NODE_EMPTY,
+	NODE_SET, // one byte out of a set
+	NODE_CAT,
+	NODE_ALT,
+	NODE_REPEAT, // child{min,max}, max < 0 for no limit
+};
+
+typedef struct s_node
+{
+	enum e_node_type	type;
+	int					left; // child (or first child)
+	int					right; // second child of CAT and ALT
+	int					min;
+	int					max;
+	t_byteset			set;
+}	t_node;
+
+typedef struct s_parser
+{
+	const unsigned char	*re;
+	size_t				len;
+	size_t				pos;
+	int					depth;
+	t_node				*nodes;
+	int					count;
+	int					capacity;
+	const char			*error;
+}	t_parser;
+
+void set_add(t_byteset *set, int c)
+{
+	set->bits[c >> 3] |= 1 << (c & 7);
+}
+
+int set_has(const t_byteset *set, int c)
+{
+	return (set->bits[c >> 3] >> (c & 7)) & 1;
+}
+
+void set_add_range(t_byteset *set, int from, int to)
+{
+	for (int c = from; c <= to; c++)
+		set_add(set, c);
+}
+
+void set_invert(t_byteset *set)
+{
+	for (int i = 0; i < 32; i++)
+		set->bits[i] = ~set->bits[i];
+}
+
+int new_node(t_parser *p, enum e_node_type type, int left, int right)
+{
+	if (p->count == p->capacity)
+	{
+		int new_capacity = p->capacity ? p->capacity * 2 : 64;
+		t_node *tmp = realloc(p->nodes, sizeof(t_node) * new_capacity);
+		if (!tmp)
+		{
+			p->error = "out of memory";
+			return -1;
+		}
+		p->nodes = tmp;
+		p->capacity = new_capacity;
+	}
+	t_node *node = &p->nodes[p->count];
+	memset(node, 0, sizeof(*node));
+	node->type = type;
+	node->left = left;
+	node->right = right;
+	return p->count++;
+}
+
+int peek(const t_parser *p)
+{
+	return p->pos < p->len ? p->re[p->pos] : -1;
+}
+
+// \d \w \s and their negations, added to set; returns 0 if c is not one of them
+int class_escape(int c, t_byteset *set)
+{
+	t_byteset class;
+	int lower = c | 0x20;
+	memset(&class, 0, sizeof(class));
+	if (lower == 'd')
+		set_add_range(&class, '0', '9');
+	else if (lower == 'w')
+	{
+		set_add_range(&class, 'a', 'z');
+		set_add_range(&class, 'A', 'Z');
+		set_add_range(&class, '0', '9');
+		set_add(&class, '_');
+	}
+	else if (lower == 's')
+	{
+		set_add_range(&class, '\t', '\r'); // \t \n \v \f \r
+		set_add(&class, ' ');
+	}
+	else
+		return 0;
+	if (c != lower) // \D \W \S
+		set_invert(&class);
+	for (int i = 0; i < 32; i++)
+		set->bits[i] |= class.bits[i];
+	return 1;
+}
+
+// the byte a backslash sequence (other than a class) stands for
+int escaped_byte(int c)
+{
+	if (c == 'n')
+		return '\n';
+	if (c == 't')
+		return '\t';
+	if (c == 'r')
+		return '\r';
+	return c;
+}
+
+// after '[': one class up to the closing ']'
+int parse_class(t_parser *p, t_byteset *set)
+{
+	int negate = 0;
+	if (peek(p) == '^')
+	{
+		negate = 1;
+		p->pos++;
+	}
+	int first = 1;
+	while (peek(p) != ']' || first)
+	{
+		int c = peek(p);
+		first = 0;
+		if (c < 0)
+		{
+			p->error = "missing ]";
+			return -1;
+		}
+		p->pos++;
+		if (c == '\\')
+		{
+			if (p->pos == p->len)
+			{
+				p->error = "trailing backslash";
+				return -1;
+			}
+			c = p->re[p->pos++];
+			if (class_escape(c, set))
+				continue ;
+			c = escaped_byte(c);
+		}
+		// a range, unless the '-' is the last byte of the class
+		if (peek(p) == '-' && p->pos + 1 < p->len && p->re[p->pos + 1] != ']')
+		{
+			p->pos++;
+			int to = p->re[p->pos++];
+			if (to == '\\' && p->pos < p->len)
+				to = escaped_byte(p->re[p->pos++]);
+			if (to < c)
+			{
+				p->error = "invalid range in class";
+				return -1;
+			}
+			set_add_range(set, c, to);
+		}
+		else
+			set_add(set, c);
+	}
+	p->pos++; // ']'
+	if (negate)
+		set_invert(set);
+	return 0;
+}
+
+int parse_alt(t_parser *p);
+
+int parse_atom(t_parser *p)
+{
+	int c = peek(p);
+	if (c == '(')
+	{
+		if (++p->depth > MAX_DEPTH)
+		{
+			p->error = "too many nested groups";
+			return -1;
+		}
+		p->pos++;
+		int node = parse_alt(p);
+		if (node < 0)
+			return -1;
+		if (peek(p) != ')')
+		{
+			p->error = "missing )";
+			return -1;
+		}
+		p->pos++;
+		p->depth--;
+		return node;
+	}
+	int node = new_node(p, NODE_SET, -1, -1);
+	if (node < 0)
+		return -1;
+	t_byteset *set = &p->nodes[node].set;
+	p->pos++;
+	if (c == '.')
+	{
+		set_invert(set);
+		set->bits['\n' >> 3] &= ~(1 << ('\n' & 7));
+	}
+	else if (c == '[')
+	{
+		if (parse_class(p, set) != 0)
+			return -1;
+	}
+	else if (c == '\\')
+	{
+		if (p->pos == p->len)
+		{
+			p->error = "trailing backslash";
+			return -1;
+		}
+		c = p->re[p->pos++];
+		if (!class_escape(c, set))
+			set_add(set, escaped_byte(c));
+	}
+	else if (c == '*' || c == '+' || c == '?' || c == '{')
+	{
+		p->error = "nothing to repeat";
+		return -1;
+	}
+	else if (c == ']')
+	{
+		p->error = "unmatched ]";
+		return -1;
+	}
+	else
+		set_add(set, c);
+	return node;
+}
+
+// a decimal number of a {m,n} bound
+int parse_bound(t_parser *p)
+{
+	int n = 0;
+	if (peek(p) < '0' || peek(p) > '9')
+		return -1;
+	while (peek(p) >= '0' && peek(p) <= '9')
+	{
+		n = n * 10 + (p->re[p->pos++] - '0');
+		if (n > REPEAT_MAX)
+			return -1;
+	}
+	return n;
+}
+
+// an atom followed by any number of * + ? {m,n}
+int parse_repeat(t_parser *p)
+{
+	int node = parse_atom(p);
+	while (node >= 0)
+	{
+		int c = peek(p);
+		int min, max;
+		if (c == '*' || c == '+' || c == '?')
+		{
+			p->pos++;
+			min = c == '+';
+			max = c == '?' ? 1 : -1;
+		}
+		else if (c == '{')
+		{
+			p->pos++;
+			min = parse_bound(p);
+			max = min;
+			if (min >= 0 && peek(p) == ',')
+			{
+				p->pos++;
+				max = peek(p) == '}' ? -1 : parse_bound(p);
+				if (max == -1 && peek(p) != '}')
+					min = -1;
+			}
+			if (min < 0 || peek(p) != '}' || (max >= 0 && max < min))
+			{
+				p->error = "invalid {m,n} repetition";
+				return -1;
+			}
+			p->pos++;
+		}
+		else
+			break ;
+		int child = node;
+		node = new_node(p, NODE_REPEAT, child, -1);
+		if (node >= 0)
+		{
+			p->nodes[node].min = min;
+			p->nodes[node].max = max;
+		}
+	}
+	return node;
+}
+
+int parse_concat(t_parser *p)
+{
+	int node = -1;
+	while (peek(p) >= 0 && peek(p) != '|' && peek(p) != ')')
+	{
+		int next = parse_repeat(p);
+		if (next < 0)
+			return -1;
+		node = node < 0 ? next : new_node(p, NODE_CAT, node, next);
+		if (node < 0)
+			return -1;
+	}
+	if (node < 0)
+		node = new_node(p, NODE_EMPTY, -1, -1);
+	return node;
+}
+
+int parse_alt(t_parser *p)
+{
+	int node = parse_concat(p);
+	while (node >= 0 && peek(p) == '|')
+	{
+		p->pos++;
+		int right = parse_concat(p);
+		if (right < 0)
+			return -1;
+		node = new_node(p, NODE_ALT, node, right);
+	}
+	return node;
+}
+
+// the root of the syntax tree, or -1 (p->error says why)
+int parse_regex(t_parser *p, const char *re, size_t len)
+{
+	memset(p, 0, sizeof(*p));
+	p->re = (const unsigned char *)re;
+	p->len = len;
+	int root = parse_alt(p);
+	if (root >= 0 && p->pos != p->len)
+	{
+		p->error = "unmatched )";
+		root = -1;
+	}
+	return root;
+}
+
+/* --------------------------------- NFA ---------------------------------- */
+
+enum e_nfa_kind
+{
+	NFA_SET, // consume one byte of set, go to out
+	NFA_SPLIT, // go to out and out1 without consuming anything
+	NFA_MATCH,
+};
+
+typedef struct s_nfa_state
+{
+	enum e_nfa_kind	kind;
+	int				out;
+	int				out1;
+	t_byteset		set;
+}	t_nfa_state;
+
+typedef struct s_nfa
+{
+	t_nfa_state	*states;
+	int			count;
+	int			capacity;
+}	t_nfa;
+
+int nfa_state(t_nfa *nfa, enum e_nfa_kind kind, int out, int out1)
+{
+	if (nfa->count == MAX_NFA_STATES)
+		return -1;
+	if (nfa->count == nfa->capacity)
+	{
+		int new_capacity = nfa->capacity ? nfa->capacity * 2 : 64;
+		t_nfa_state *tmp = realloc(nfa->states, sizeof(t_nfa_state) * new_capacity);
+		if (!tmp)
+			return -1;
+		nfa->states = tmp;
+		nfa->capacity = new_capacity;
+	}
+	t_nfa_state *s = &nfa->states[nfa->count];
+	memset(s, 0, sizeof(*s));
+	s->kind = kind;
+	s->out = out;
+	s->out1 = out1;
+	return nfa->count++;
+}
+
+/* Build the states for the tree under node, leading to the state 'next' once
+it has matched; returns the entry state. Building back to front means every
+target already exists when a state is created. */
+int compile(t_nfa *nfa, const t_parser *p, int node, int next)
+{
+	const t_node *n = &p->nodes[node];
+	int s, start;
+	if (next < 0)
+		return -1;
+	switch (n->type)
+	{
+		case NODE_EMPTY:
+			return next;
+		case NODE_SET:
+			s = nfa_state(nfa, NFA_SET, next, -1);
+			if (s >= 0)
+				nfa->states[s].set = n->set;
+			return s;
+		case NODE_CAT:
+			return compile(nfa, p, n->left, compile(nfa, p, n->right, next));
+		case NODE_ALT:
+			start = compile(nfa, p, n->left, next);
+			s = compile(nfa, p, n->right, next);
+			if (start < 0 || s < 0)
+				return -1;
+			return nfa_state(nfa, NFA_SPLIT, start, s);
+		case NODE_REPEAT:
+			if (n->max < 0)
+			{
+				// x* loops on a split state; x{m,} is m copies of x followed by x*
+				s = nfa_state(nfa, NFA_SPLIT, -1, next);
+				if (s < 0)
+					return -1;
+				start = compile(nfa, p, n->left, s);
+				if (start < 0)
+					return -1;
+				nfa->states[s].out = start;
+				next = s;
+			}
+			else
+			{
+				// the optional copies: x{m,n} is x...x (m times) x?...x? (n - m times)
+				for (int i = n->min; i < n->max && next >= 0; i++)
+				{
+					start = compile(nfa, p, n->left, next);
+					next = start < 0 ? -1 : nfa_state(nfa, NFA_SPLIT, start, next);
+				}
+			}
+			for (int i = 0; i < n->min && next >= 0; i++)
+				next = compile(nfa, p, n->left, next);
+			return next;
+	}
+	return -1;
+}
+
+/* --------------------------------- DFA ---------------------------------- */
+
+typedef struct s_dfa
+{
+	int				nstates;
+	int				nclasses;
+	int				start;
+	int				dead; // the state no match can leave
+	int				class_of[256];
+	int				*delta; // nstates rows of nclasses entries
+	unsigned char	*accept;
+}	t_dfa;
+
+// the file layout of the cache: header, regex, class_of, accept, delta
+typedef struct s_cache_header
+{
+	char	magic[8];
+	int		regex_len;
+	int		nstates;
+	int		nclasses;
+	int		start;
+	int		dead;
+}	t_cache_header;
+
+void free_dfa(t_dfa *dfa)
+{
+	free(dfa->delta);
+	free(dfa->accept);
+	dfa->delta = NULL;
+	dfa->accept = NULL;
+}
+
+// bytes that every NFA set treats the same way share a class
+int byte_classes(const t_nfa *nfa, int *class_of, int *rep)
+{
+	int nclasses = 1;
+	memset(class_of, 0, sizeof(int) * 256);
+	for (int s = 0; s < nfa->count; s++)
+	{
+		if (nfa->states[s].kind != NFA_SET)
+			continue ;
+		// split every class in (inside the set, outside the set)
+		int inside[256];
+		for (int c = 0; c < nclasses; c++)
+			inside[c] = -1;
+		for (int b = 0; b < 256; b++)
+		{
+			if (!set_has(&nfa->states[s].set, b))
+				continue ;
+			int c = class_of[b];
+			if (inside[c] < 0)
+				inside[c] = nclasses++;
+			class_of[b] = inside[c];
+		}
+		// a class that was entirely inside leaves a hole: renumber densely
+		int used[512];
+		int id = 0;
+		memset(used, -1, sizeof(used));
+		for (int b = 0; b < 256; b++)
+		{
+			if (used[class_of[b]] < 0)
+				used[class_of[b]] = id++;
+			class_of[b] = used[class_of[b]];
+		}
+		nclasses = id;
+	}
+	for (int b = 255; b >= 0; b--)
+		rep[class_of[b]] = b;
+	return nclasses;
+}
+
+// the sets of NFA states met during subset construction, with a hash index
+typedef struct s_subsets
+{
+	int			*pool; // all the sets, one after the other (sorted state numbers)
+	size_t		pool_len;
+	size_t		pool_cap;
+	size_t		*offset; // where set i starts in pool
+	int			*len;
+	int			count;
+	int			*table; // open addressing, -1 for empty
+	int			table_size;
+}	t_subsets;
+
+unsigned long long hash_ints(const int *v, int n)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < n; i++)
+	{
+		h ^= (unsigned int)v[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// the number of the set v[0..n), which is added if it is new; -1 on error
+int subset_id(t_subsets *sub, const int *v, int n)
+{
+	unsigned int i = hash_ints(v, n) & (sub->table_size - 1);
+	while (sub->table[i] >= 0)
+	{
+		int id = sub->table[i];
+		if (sub->len[id] == n
+			&& (n == 0 || memcmp(sub->pool + sub->offset[id], v, sizeof(int) * n) == 0))
+			return id;
+		i = (i + 1) & (sub->table_size - 1);
+	}
+	if (sub->count == MAX_DFA_STATES)
+		return -1;
+	if (sub->pool_len + n > sub->pool_cap)
+	{
+		size_t new_cap = (sub->pool_cap + n) * 2;
+		int *tmp = realloc(sub->pool, sizeof(int) * new_cap);
+		if (!tmp)
+			return -1;
+		sub->pool = tmp;
+		sub->pool_cap = new_cap;
+	}
+	if (n > 0)
+		memcpy(sub->pool + sub->pool_len, v, sizeof(int) * n);
+	sub->offset[sub->count] = sub->pool_len;
+	sub->len[sub->count] = n;
+	sub->pool_len += n;
+	sub->table[i] = sub->count;
+	return sub->count++;
+}
+
+int cmp_int(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+/* Epsilon closure of the n seed states in list: the SET and MATCH states
+reachable through SPLIT states, sorted (the canonical form of the subset).
+mark[] holds the generation of the last closure that visited a state. */
+int closure(const t_nfa *nfa, int *list, int n, int *stack, int *mark, int gen)
+{
+	int top = 0;
+	int count = 0;
+	for (int i = 0; i < n; i++)
+		stack[top++] = list[i];
+	while (top > 0)
+	{
+		int s = stack[--top];
+		if (mark[s] == gen)
+			continue ;
+		mark[s] = gen;
+		if (nfa->states[s].kind == NFA_SPLIT)
+		{
+			stack[top++] = nfa->states[s].out1;
+			stack[top++] = nfa->states[s].out;
+		}
+		else
+			list[count++] = s;
+	}
+	qsort(list, count, sizeof(int), cmp_int);
+	return count;
+}
+
+// the work arrays of the subset construction
+typedef struct s_builder
+{
+	t_subsets	sub;
+	int			rep[256]; // one byte of each class
+	int			*list;
+	int			*stack;
+	int			*mark;
+	int			gen;
+}	t_builder;
+
+void free_builder(t_builder *b)
+{
+	free(b->sub.pool);
+	free(b->sub.offset);
+	free(b->sub.len);
+	free(b->sub.table);
+	free(b->list);
+	free(b->stack);
+	free(b->mark);
+}
+
+// grow the DFA rows to capacity states; -1 if out of memory
+int grow_dfa(t_dfa *dfa, int capacity)
+{
+	int *delta = realloc(dfa->delta, sizeof(int) * (size_t)capacity * dfa->nclasses);
+	if (delta)
+		dfa->delta = delta;
+	unsigned char *accept = realloc(dfa->accept, capacity);
+	if (accept)
+		dfa->accept = accept;
+	return delta && accept ? 0 : -1;
+}
+
+// expand every set once, in the order it was found; -1 if out of memory or too many states
+int expand_subsets(t_builder *b, const t_nfa *nfa, int nfa_start, t_dfa *dfa)
+{
+	t_subsets *sub = &b->sub;
+	int capacity = 64;
+	if (grow_dfa(dfa, capacity) != 0)
+		return -1;
+	b->list[0] = nfa_start;
+	if (subset_id(sub, NULL, 0) != 0
+		|| (dfa->start = subset_id(sub, b->list, closure(nfa, b->list, 1, b->stack, b->mark, ++b->gen))) < 0)
+		return -1;
+	for (int d = 0; d < sub->count; d++)
+	{
+		if (d == capacity)
+		{
+			capacity *= 2;
+			if (grow_dfa(dfa, capacity) != 0)
+				return -1;
+		}
+		dfa->accept[d] = 0;
+		for (int i = 0; i < sub->len[d]; i++)
+			if (nfa->states[sub->pool[sub->offset[d] + i]].kind == NFA_MATCH)
+				dfa->accept[d] = 1;
+		for (int c = 0; c < dfa->nclasses; c++)
+		{
+			int n = 0;
+			// (sub->pool may move in subset_id(): index it again every time)
+			for (int i = 0; i < sub->len[d]; i++)
+			{
+				const t_nfa_state *s = &nfa->states[sub->pool[sub->offset[d] + i]];
+				if (s->kind == NFA_SET && set_has(&s->set, b->rep[c]))
+					b->list[n++] = s->out;
+			}
+			n = closure(nfa, b->list, n, b->stack, b->mark, ++b->gen);
+			int next = subset_id(sub, b->list, n);
+			if (next < 0)
+				return -1;
+			dfa->delta[(size_t)d * dfa->nclasses + c] = next;
+		}
+	}
+	dfa->nstates = sub->count;
+	dfa->dead = 0;
+	return 0;
+}
+
+/* Subset construction: DFA state i is the set number i. Set 0 is the empty
+set, that is the dead state. */
+int build_dfa(const t_nfa *nfa, int nfa_start, t_dfa *dfa)
+{
+	t_builder b;
+	memset(&b, 0, sizeof(b));
+	memset(dfa, 0, sizeof(*dfa));
+	dfa->nclasses = byte_classes(nfa, dfa->class_of, b.rep);
+	b.sub.table_size = 1;
+	while (b.sub.table_size < 2 * MAX_DFA_STATES)
+		b.sub.table_size *= 2;
+	b.sub.table = malloc(sizeof(int) * b.sub.table_size);
+	b.sub.offset = malloc(sizeof(size_t) * MAX_DFA_STATES);
+	b.sub.len = malloc(sizeof(int) * MAX_DFA_STATES);
+	b.list = malloc(sizeof(int) * nfa->count);
+	b.stack = malloc(sizeof(int) * (3 * nfa->count + 1)); // seeds + 2 per split
+	b.mark = calloc(nfa->count, sizeof(int));
+	int ret = -1;
+	if (b.sub.table && b.sub.offset && b.sub.len && b.list && b.stack && b.mark)
+	{
+		memset(b.sub.table, -1, sizeof(int) * b.sub.table_size);
+		ret = expand_subsets(&b, nfa, nfa_start, dfa);
+	}
+	if (ret != 0)
+		free_dfa(dfa);
+	free_builder(&b);
+	return ret;
+}
+
+// do s and t have the same signature: same block, same blocks after every class
+int same_signature(const t_dfa *dfa, const int *block, int s, int t)
+{
+	if (block[s] != block[t])
+		return 0;
+	const int *rs = dfa->delta + (size_t)s * dfa->nclasses;
+	const int *rt = dfa->delta + (size_t)t * dfa->nclasses;
+	for (int c = 0; c < dfa->nclasses; c++)
+		if (block[rs[c]] != block[rt[c]])
+			return 0;
+	return 1;
+}
+
+unsigned long long signature_hash(const t_dfa *dfa, const int *block, int s)
+{
+	const int *row = dfa->delta + (size_t)s * dfa->nclasses;
+	unsigned long long h = 14695981039346656037ULL ^ (unsigned int)block[s];
+	for (int c = 0; c < dfa->nclasses; c++)
+	{
+		h *= 1099511628211ULL;
+		h ^= (unsigned int)block[row[c]];
+	}
+	return h * 1099511628211ULL;
+}
+
+/* Moore's algorithm: start from two blocks (accepting or not) and split every
+block by where its states go, class by class, until no block splits any more.
+The blocks are then the states of the minimal DFA. */
+int minimize_dfa(t_dfa *dfa)
+{
+	int n = dfa->nstates;
+	int table_size = 1;
+	while (table_size < 2 * n)
+		table_size *= 2;
+	int *block = malloc(sizeof(int) * n);
+	int *new_block = malloc(sizeof(int) * n);
+	int *table = malloc(sizeof(int) * table_size);
+	int *first = malloc(sizeof(int) * n); // a state of every block
+	if (!block || !new_block || !table || !first)
+	{
+		free(block);
+		free(new_block);
+		free(table);
+		free(first);
+		return -1;
+	}
+	for (int s = 0; s < n; s++)
+		block[s] = dfa->accept[s];
+	int nblocks = -1;
+	while (1)
+	{
+		int count = 0;
+		memset(table, -1, sizeof(int) * table_size);
+		for (int s = 0; s < n; s++)
+		{
+			unsigned int i = signature_hash(dfa, block, s) & (table_size - 1);
+			while (table[i] >= 0 && !same_signature(dfa, block, first[table[i]], s))
+				i = (i + 1) & (table_size - 1);
+			if (table[i] < 0)
+			{
+				table[i] = count;
+				first[count++] = s;
+			}
+			new_block[s] = table[i];
+		}
+		int *tmp = block;
+		block = new_block;
+		new_block = tmp;
+		if (count == nblocks)
+			break ;
+		nblocks = count;
+	}
+	// the minimal DFA: row b is the row of any state of block b
+	for (int b = 0; b < nblocks; b++)
+	{
+		int *from = dfa->delta + (size_t)first[b] * dfa->nclasses;
+		int *to = dfa->delta + (size_t)b * dfa->nclasses;
+		for (int c = 0; c < dfa->nclasses; c++)
+			to[c] = block[from[c]];
+		dfa->accept[b] = dfa->accept[first[b]];
+	}
+	dfa->start = block[dfa->start];
+	dfa->dead = block[dfa->dead];
+	dfa->nstates = nblocks;
+	free(block);
+	free(new_block);
+	free(table);
+	free(first);
+	return 0;
+}
+
+// regex to minimal DFA; on failure *error says why
+int compile_regex(const char *re, size_t len, t_dfa *dfa, const char **error)
+{
+	t_parser p;
+	t_nfa nfa = {NULL, 0, 0};
+	int ret = -1;
+	int root = parse_regex(&p, re, len);
+	*error = p.error;
+	if (root >= 0)
+	{
+		int match = nfa_state(&nfa, NFA_MATCH, -1, -1);
+		int start = compile(&nfa, &p, root, match);
+		*error = "regex too large";
+		if (start >= 0 && build_dfa(&nfa, start, dfa) == 0)
+		{
+			ret = minimize_dfa(dfa);
+			if (ret != 0)
+				free_dfa(dfa);
+		}
+	}
+	free(p.nodes);
+	free(nfa.states);
+	return ret;
+}
+
+/* -------------------------------- cache --------------------------------- */
+
+// FNV-1a, 64 bits
+unsigned long long fnv64(const char *s, size_t len)
+{
+	unsigned long long h = 14695981039346656037ULL;
+	for (size_t i = 0; i < len; i++)
+	{
+		h ^= (unsigned char)s[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+// mkdir -p: create the directories of path that do not exist yet
+void make_dirs(char *path)
+{
+	for (char *p = path + 1; *p; p++)
+	{
+		if (*p != '/')
+			continue ;
+		*p = '\0';
+		mkdir(path, 0700);
+		*p = '/';
+	}
+	mkdir(path, 0700);
+}
+
+// <cache dir>/filter_regex/<hash>.dfa, creating the directories; 0 if no home
+int cache_path(char *path, size_t size, const char *re, size_t len)
+{
+	const char *base = getenv("XDG_CACHE_HOME");
+	int n;
+	if (base && base[0] == '/')
+		n = snprintf(path, size, "%s/filter_regex", base);
+	else if ((base = getenv("HOME")) != NULL && base[0] == '/')
+		n = snprintf(path, size, "%s/.cache/filter_regex", base);
+	else
+		return 0;
+	if (n < 0 || (size_t)n >= size)
+		return 0;
+	make_dirs(path);
+	n = snprintf(path + n, size - n, "/%016llx.dfa", fnv64(re, len));
+	return n > 0 && (size_t)n < size;
+}
+
+// 0 if the next len bytes of the file are the regex itself (no hash collision)
+int same_regex(FILE *file, const char *re, size_t len)
+{
+	char *stored = malloc(len + 1);
+	if (!stored)
+		return -1;
+	int ret = fread(stored, 1, len, file) == len && memcmp(stored, re, len) == 0 ? 0 : -1;
+	free(stored);
+	return ret;
+}
+
+// read the cached DFA after its header; -1 if anything is missing or out of range
+int read_cache(FILE *file, const t_cache_header *header, const char *re, size_t len, t_dfa *dfa)
+{
+	size_t cells = (size_t)header->nstates * header->nclasses;
+	dfa->accept = malloc(header->nstates);
+	dfa->delta = malloc(sizeof(int) * cells);
+	if (!dfa->accept || !dfa->delta || same_regex(file, re, len) != 0
+		|| fread(dfa->class_of, sizeof(int), 256, file) != 256
+		|| fread(dfa->accept, 1, header->nstates, file) != (size_t)header->nstates
+		|| fread(dfa->delta, sizeof(int), cells, file) != cells)
+		return -1;
+	// never trust a file: every entry must be in range
+	for (int b = 0; b < 256; b++)
+		if (dfa->class_of[b] < 0 || dfa->class_of[b] >= header->nclasses)
+			return -1;
+	for (size_t i = 0; i < cells; i++)
+		if (dfa->delta[i] < 0 || dfa->delta[i] >= header->nstates)
+			return -1;
+	dfa->nstates = header->nstates;
+	dfa->nclasses = header->nclasses;
+	dfa->start = header->start;
+	dfa->dead = header->dead;
+	return 0;
+}
+
+// 0 if the cache file holds a valid DFA for this very regex
+int load_cache(const char *path, const char *re, size_t len, t_dfa *dfa)
+{
+	t_cache_header header;
+	FILE *file = fopen(path, "rb");
+	if (!file)
+		return -1;
+	memset(dfa, 0, sizeof(*dfa));
+	int ret = -1;
+	if (fread(&header, sizeof(header), 1, file) == 1
+		&& memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0
+		&& header.regex_len == (int)len && header.nstates > 0
+		&& header.nstates <= MAX_DFA_STATES && header.nclasses > 0 && header.nclasses <= 256
+		&& header.start >= 0 && header.start < header.nstates
+		&& header.dead >= 0 && header.dead < header.nstates)
+		ret = read_cache(file, &header, re, len, dfa);
+	if (ret != 0)
+		free_dfa(dfa);
+	fclose(file);
+	return ret;
+}
+
+// write to a temporary file, then rename(): readers never see half a file
+void save_cache(const char *path, const char *re, size_t len, const t_dfa *dfa)
+{
+	t_cache_header header;
+	char tmp[4096];
+	if (snprintf(tmp, sizeof(tmp), "%s.%ld.tmp", path, (long)getpid()) >= (int)sizeof(tmp))
+		return ;
+	FILE *file = fopen(tmp, "wb");
+	if (!file)
+		return ;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+	header.regex_len = len;
+	header.nstates = dfa->nstates;
+	header.nclasses = dfa->nclasses;
+	header.start = dfa->start;
+	header.dead = dfa->dead;
+	size_t cells = (size_t)dfa->nstates * dfa->nclasses;
+	int ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(re, 1, len, file) == len
+		&& fwrite(dfa->class_of, sizeof(int), 256, file) == 256
+		&& fwrite(dfa->accept, 1, dfa->nstates, file) == (size_t)dfa->nstates
+		&& fwrite(dfa->delta, sizeof(int), cells, file) == cells;
+	if (fclose(file) != 0)
+		ok = 0;
+	if (!ok || rename(tmp, path) != 0)
+		unlink(tmp);
+}
+
+/* ------------------------------- matching ------------------------------- */
+
+/* the run of the DFA from one start offset, kept in runs[start - base]. Runs
+that reach the same DFA state join one group, led by the newest of them (the
+leader is decided last, so it stays in the buffer as long as its group), and
+only the leader is stepped. Offsets are stored relative to the run's own start:
+they fit, the buffer is at most 2 * REGEX_MATCH_MAX bytes */
+typedef struct s_run
+{
+	int				state; // DFA state while it leads its group, dead once stopped
+	unsigned int	last; // end of its longest match - start, 0 if none
+	unsigned int	parent; // the run it joined - start, 0 while it leads
+	unsigned int	merged; // when it joined - start
+}	t_run;
+
+// what the single pass remembers between two bytes
+typedef struct s_scan
+{
+	const t_dfa			*dfa;
+	char				*buf; // the input from offset base on
+	t_run				*runs; // the run of each offset, same indexes as buf
+	unsigned long long	base;
+	unsigned long long	*leaders; // the groups still running
+	unsigned long long	*next; // (the new leaders, built by step())
+	int					nleaders;
+	unsigned int		*claimed; // claimed[state] == gen: a group is there now
+	int					*claimer; // its index in next
+	unsigned int		gen;
+	unsigned char		can_start[256]; // the bytes that can begin a match
+	int					stopped; // a group stopped: decide() has work
+	unsigned long long	head; // the next start to decide
+	unsigned long long	emit; // the first byte not written yet
+	t_writer			*out;
+}	t_scan;
+
+#define RUN(sc, offset) (&(sc)->runs[(offset) - (sc)->base])
+
+/* the leader of the group of x. The links are shortened on the way (x then
+points straight at its leader), folding in the matches of the runs in between
+that x shares: those that end after x joined them. */
+static unsigned long long find_leader(t_scan *sc, unsigned long long x)
+{
+	unsigned long long y = x, below = x;
+	// up to the leader, turning the links around to come back down
+	while (RUN(sc, y)->parent)
+	{
+		unsigned long long up = y + RUN(sc, y)->parent;
+		RUN(sc, y)->parent = y - below;
+		below = y;
+		y = up;
+	}
+	unsigned long long leader = y, upper = leader;
+	y = below;
+	while (y != leader)
+	{
+		t_run *run = RUN(sc, y);
+		unsigned long long down = y - run->parent;
+		if (upper != leader)
+		{
+			t_run *up = RUN(sc, upper);
+			if (up->last && upper + up->last > y + run->merged)
+				run->last = upper + up->last - y;
+			run->merged = upper + up->merged - y;
+		}
+		run->parent = leader - y;
+		if (y == x)
+			break ;
+		upper = y;
+		y = down;
+	}
+	return leader;
+}
+
+// end of the longest match from x, once its group stopped; 0 if none
+static unsigned long long match_end(t_scan *sc, unsigned long long x, unsigned long long leader)
+{
+	t_run *run = RUN(sc, x);
+	if (leader != x)
+	{
+		t_run *lead = RUN(sc, leader);
+		if (lead->last && leader + lead->last > x + run->merged)
+			return leader + lead->last;
+	}
+	return run->last ? x + run->last : 0;
+}
+
+/* feed the byte at offset i to every running group, and start a run there.
+At most one group per DFA state is left, so this costs at most the number
+of DFA states, whatever the input. */
+static void step(t_scan *sc, unsigned char byte, unsigned long long i)
+{
+	// (local copies: the stores below could alias the fields for the compiler)
+	const int *delta = sc->dfa->delta;
+	const unsigned char *accept = sc->dfa->accept;
+	int nclasses = sc->dfa->nclasses;
+	int dead = sc->dfa->dead;
+	int c = sc->dfa->class_of[byte];
+	t_run *runs = sc->runs;
+	unsigned long long base = sc->base;
+	unsigned long long *next = sc->next;
+	unsigned int *claimed = sc->claimed;
+	int *claimer = sc->claimer;
+	int nleaders = sc->nleaders;
+	int n = 0;
+
+	if (sc->can_start[byte]) // (else no run at all, decide() skips it)
+	{
+		t_run *fresh = &runs[i - base];
+		fresh->state = sc->dfa->start;
+		fresh->last = 0;
+		fresh->parent = 0;
+		fresh->merged = 0;
+		sc->leaders[nleaders++] = i;
+	}
+	if (nleaders <= 1) // a group alone has nobody to join
+	{
+		sc->nleaders = nleaders;
+		if (nleaders == 1)
+		{
+			t_run *run = &runs[sc->leaders[0] - base];
+			run->state = delta[(size_t)run->state * nclasses + c];
+			if (run->state == dead)
+			{
+				sc->nleaders = 0;
+				sc->stopped = 1;
+			}
+			else if (accept[run->state])
+				run->last = i + 1 - sc->leaders[0];
+		}
+		return ;
+	}
+	unsigned int gen = ++sc->gen;
+	if (gen == 0) // wrapped: forget the old marks
+	{
+		memset(claimed, 0, sizeof(unsigned int) * sc->dfa->nstates);
+		gen = sc->gen = 1;
+	}
+	for (int k = 0; k < nleaders; k++)
+	{
+		unsigned long long x = sc->leaders[k];
+		t_run *run = &runs[x - base];
+		int state = delta[(size_t)run->state * nclasses + c];
+		run->state = state;
+		if (state == dead) // stopped: its starts can be decided
+		{
+			sc->stopped = 1;
+			continue ;
+		}
+		if (claimed[state] == gen)
+		{
+			// the older group joins the newer one
+			unsigned long long y = next[claimer[state]];
+			unsigned long long older = x < y ? x : y;
+			unsigned long long newer = x < y ? y : x;
+			runs[older - base].parent = newer - older;
+			runs[older - base].merged = i - older;
+			next[claimer[state]] = newer;
+			if (newer == y)
+				continue ;
+		}
+		else
+		{
+			claimed[state] = gen;
+			claimer[state] = n++;
+		}
+		if (accept[state])
+			run->last = i + 1 - x;
+		next[claimer[state]] = x;
+	}
+	sc->next = sc->leaders;
+	sc->leaders = next;
+	sc->nleaders = n;
+}
+
+/* decide the starts in order, up to the first one whose group still runs:
+mask its longest match and go on after it, or go on with the next start */
+static void decide(t_scan *sc, unsigned long long pos)
+{
+	sc->stopped = 0;
+	while (sc->head < pos)
+	{
+		unsigned long long x = sc->head;
+		if (!sc->can_start[(unsigned char)sc->buf[x - sc->base]])
+		{
+			sc->head++;
+			continue ;
+		}
+		unsigned long long leader = find_leader(sc, x);
+		if (RUN(sc, leader)->state != sc->dfa->dead)
+			return ;
+		unsigned long long end = match_end(sc, x, leader);
+		if (!end)
+		{
+			sc->head++;
+			continue ;
+		}
+		writer_bytes(sc->out, sc->buf + (sc->emit - sc->base), x - sc->emit);
+		writer_fill(sc->out, '*', end - x);
+		sc->emit = end;
+		sc->head = end;
+		// a group led by a start before it only has starts given up
+		for (int k = 0; k < sc->nleaders; k++)
+			if (sc->leaders[k] < end)
+				sc->leaders[k--] = sc->leaders[--sc->nleaders];
+	}
+}
+
+/* a single group running: feed it the bytes where no other match can begin
+in a tight loop, without the bookkeeping of step() */
+static unsigned long long run_alone(t_scan *sc, unsigned long long pos, unsigned long long end)
+{
+	const t_dfa *dfa = sc->dfa;
+	unsigned long long x = sc->leaders[0];
+	t_run *run = RUN(sc, x);
+	int state = run->state;
+	while (pos < end && !sc->can_start[(unsigned char)sc->buf[pos - sc->base]])
+	{
+		state = dfa->delta[(size_t)state * dfa->nclasses + dfa->class_of[(unsigned char)sc->buf[pos - sc->base]]];
+		pos++;
+		if (state == dfa->dead)
+		{
+			sc->nleaders = 0;
+			sc->stopped = 1;
+			break ;
+		}
+		if (dfa->accept[state])
+			run->last = pos - x;
+	}
+	run->state = state;
+	return pos;
+}
+
+// stop the group of the oldest undecided start (too long) and decide again
+void stop_oldest(t_scan *sc, unsigned long long pos)
+{
+	unsigned long long leader = find_leader(sc, sc->head);
+	RUN(sc, leader)->state = sc->dfa->dead;
+	for (int k = 0; k < sc->nleaders; k++)
+		if (sc->leaders[k] == leader)
+			sc->leaders[k] = sc->leaders[--sc->nleaders];
+	decide(sc, pos);
+}
+
+void free_scan(t_scan *sc)
+{
+	free(sc->buf);
+	free(sc->runs);
+	free(sc->leaders);
+	free(sc->next);
+	free(sc->claimed);
+	free(sc->claimer);
+}
+
+// stream in_fd to out_fd, masking the leftmost-longest non-empty matches
+int filter_regex(const t_dfa *dfa, int in_fd, int out_fd)
+{
+	t_writer *out = malloc(sizeof(t_writer));
+	t_scan sc;
+	size_t cap = STREAM_BLOCK_SIZE;
+
+	memset(&sc, 0, sizeof(sc));
+	sc.dfa = dfa;
+	sc.out = out;
+	sc.buf = malloc(cap);
+	sc.runs = malloc(sizeof(t_run) * cap);
+	sc.leaders = malloc(sizeof(unsigned long long) * (dfa->nstates + 1));
+	sc.next = malloc(sizeof(unsigned long long) * (dfa->nstates + 1));
+	sc.claimed = calloc(dfa->nstates, sizeof(unsigned int));
+	sc.claimer = malloc(sizeof(int) * dfa->nstates);
+	if (!out || !sc.buf || !sc.runs || !sc.leaders || !sc.next || !sc.claimed || !sc.claimer)
+	{
+		free(out);
+		free_scan(&sc);
+		return -1;
+	}
+	writer_init(out, out_fd);
+	int ret = 0;
+	// memchr() for the next start when only one byte can begin a match
+	int nstart = 0, start_byte = 0;
+	for (int b = 0; b < 256; b++)
+	{
+		sc.can_start[b] = dfa->delta[(size_t)dfa->start * dfa->nclasses + dfa->class_of[b]] != dfa->dead;
+		if (sc.can_start[b])
+		{
+			nstart++;
+			start_byte = b;
+		}
+	}
+	size_t avail = 0; // bytes in buf, from offset sc.base
+	unsigned long long pos = 0; // offset of the next byte to feed
+	int eof = 0;
+	while (ret == 0)
+	{
+		unsigned long long end = sc.base + avail;
+		while (pos < end)
+		{
+			// nothing pending: jump to the next byte that can begin a match
+			if (sc.nleaders == 0 && sc.head == pos)
+			{
+				const char *from = sc.buf + (pos - sc.base);
+				const char *p = from;
+				if (nstart == 1)
+					p = memchr(from, start_byte, end - pos);
+				else
+					while (p < sc.buf + avail && !sc.can_start[(unsigned char)*p])
+						p++;
+				if (!p || p == sc.buf + avail)
+					pos = end;
+				else
+					pos += p - from;
+				sc.head = pos;
+				if (pos == end)
+					break ;
+			}
+			if (sc.nleaders == 1 && !sc.can_start[(unsigned char)sc.buf[pos - sc.base]])
+				pos = run_alone(&sc, pos, end);
+			else
+			{
+				step(&sc, sc.buf[pos - sc.base], pos);
+				pos++;
+			}
+			if (sc.stopped)
+				decide(&sc, pos);
+		}
+		// at the end of the input every group stops where it is, and so does
+		// a group that keeps a start undecided for more than REGEX_MATCH_MAX
+		if (eof)
+		{
+			for (int k = 0; k < sc.nleaders; k++)
+				RUN(&sc, sc.leaders[k])->state = dfa->dead;
+			sc.nleaders = 0;
+			decide(&sc, pos);
+		}
+		while (pos - sc.head > REGEX_MATCH_MAX)
+			stop_oldest(&sc, pos);
+		// the bytes before head are decided: write them
+		writer_bytes(out, sc.buf + (sc.emit - sc.base), sc.head - sc.emit);
+		sc.emit = sc.head;
+		if (eof)
+			break ;
+		if (avail == cap)
+		{
+			if (end - sc.head <= cap / 2) // slide the undecided bytes to the front
+			{
+				avail = end - sc.head;
+				memmove(sc.buf, sc.buf + (sc.head - sc.base), avail);
+				memmove(sc.runs, sc.runs + (sc.head - sc.base), sizeof(t_run) * avail);
+				sc.base = sc.head;
+			}
+			else // at most about 4 * REGEX_MATCH_MAX
+			{
+				char *tmp = realloc(sc.buf, cap * 2);
+				if (tmp)
+					sc.buf = tmp;
+				t_run *runs = tmp ? realloc(sc.runs, sizeof(t_run) * cap * 2) : NULL;
+				if (!runs)
+				{
+					ret = -1;
+					break ;
+				}
+				sc.runs = runs;
+				cap *= 2;
+			}
+		}
+		ssize_t bytes = read(in_fd, sc.buf + avail, cap - avail);
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue ;
+			ret = -1;
+			break ;
+		}
+		if (bytes == 0)
+			eof = 1;
+		avail += bytes;
+	}
+	if (writer_flush(out) != 0)
+		ret = -1;
+	int saved_errno = errno;
+	free(out);
+	free_scan(&sc);
+	errno = saved_errno;
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	t_dfa dfa;
+	char path[4096];
+	const char *error = NULL;
+	int use_cache = 1;
+	int arg = 1;
+
+	if (argc == 3 && strcmp(argv[1], "--no-cache") == 0)
+	{
+		use_cache = 0;
+		arg = 2;
+	}
+	// one and only one non-empty regex
+	if (argc != arg + 1 || argv[arg] == NULL || strlen(argv[arg]) == 0)
+		return 1;
+	const char *re = argv[arg];
+	size_t len = strlen(re);
+	if (use_cache)
+		use_cache = cache_path(path, sizeof(path), re, len);
+	if (!use_cache || load_cache(path, re, len, &dfa) != 0)
+	{
+		if (compile_regex(re, len, &dfa, &error) != 0)
+		{
+			fprintf(stderr, "Error: %s\n", error ? error : "out of memory");
+			return 1;
+		}
+		if (use_cache)
+			save_cache(path, re, len, &dfa);
+	}
+	int ret = filter_regex(&dfa, STDIN_FILENO, STDOUT_FILENO);
+	if (ret != 0)
+	{
+		fprintf(stderr, "Error: ");
+		perror("");
+	}
+	free_dfa(&dfa);
+	return ret != 0;
+}
@@ -0,0 +1,24 @@
+/* Streaming version of filter: same behaviour as filter.c, but for inputs of
+any size (filter.c stops after 10 000 bytes) and with a few large read() and
+write() calls instead of one system call per byte. See stream.c.
+
+Compile with: gcc filter_stream.c stream.c matcher.c */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "filter.h"
+
+int main(int argc, char *argv[])
+{
+	// one and only one non-empty argument
+	if (argc != 2 || argv[1] == NULL || strlen(argv[1]) == 0)
+		return 1;
+	if (filter_stream(STDIN_FILENO, STDOUT_FILENO, argv[1], strlen(argv[1])) != 0)
+	{
+		fprintf(stderr, "Error: ");
+		perror("");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,171 @@
+/* Substring search for filter.
+
+filter.c calls ft_strncmp() at every position of the input, which costs
+O(n * m) for an input of n bytes and a search string of m bytes. The matcher
+picks an algorithm once, from the length of the search string:
+- 1 byte: memchr() (already vectorised by the libc).
+- up to SHORT_PATTERN_MAX bytes: compare the first AND the last byte of the
+pattern against 16 positions at a time (SSE2), and only check the bytes in
+between for the few positions where both match. Without SSE2, memchr() on
+the first byte is used instead.
+- longer patterns: Boyer-Moore-Horspool. The bad-character table tells how far
+the pattern can be moved when the byte under its last position does not end
+a match, which lets the search skip up to m bytes at a time.
+
+matcher_find() always returns the LEFTMOST occurrence, so a caller that
+restarts the search right after each match gets exactly filter.c's
+left-to-right, non-overlapping replacements. */
+
+#include <string.h>
+#include "filter.h"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+void matcher_init(t_matcher *m, const char *search, size_t search_len)
+{
+	m->pat = (const unsigned char *)search;
+	m->len = search_len;
+	if (search_len == 1)
+		m->kind = MATCH_BYTE;
+	else if (search_len <= SHORT_PATTERN_MAX)
+		m->kind = MATCH_SHORT;
+	else
+	{
+		m->kind = MATCH_HORSPOOL;
+		// by default a byte does not appear in the pattern: skip the whole pattern
+		for (int c = 0; c < 256; c++)
+			m->shift[c] = search_len;
+		// otherwise, line up its last occurrence (the last byte itself excluded)
+		for (size_t i = 0; i < search_len - 1; i++)
+			m->shift[m->pat[i]] = search_len - 1 - i;
+	}
+}
+
+static const char *find_short(const t_matcher *m, const char *hay, size_t hay_len)
+{
+	const unsigned char *s = (const unsigned char *)hay;
+	size_t last = m->len - 1;
+	size_t i = 0;
+
+	if (hay_len < m->len)
+		return NULL;
+#ifdef __SSE2__
+	__m128i first = _mm_set1_epi8((char)m->pat[0]);
+	__m128i end = _mm_set1_epi8((char)m->pat[last]);
+	// 16 candidate positions per step: both loads must stay inside the haystack
+	while (i + last + 16 <= hay_len)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(s + i + last));
+		unsigned int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first),
+			_mm_cmpeq_epi8(b, end)));
+		while (mask)
+		{
+			int bit = __builtin_ctz(mask);
+			if (memcmp(s + i + bit + 1, m->pat + 1, last - 1) == 0)
+				return hay + i + bit;
+			mask &= mask - 1;
+		}
+		i += 16;
+	}
+#endif
+	// the tail (or everything, without SSE2): jump from one first byte to the next
+	while (i + last < hay_len)
+	{
+		const unsigned char *p = memchr(s + i, m->pat[0], hay_len - last - i);
+		if (!p)
+			return NULL;
+		i = p - s;
+		if (s[i + last] == m->pat[last] && memcmp(s + i + 1, m->pat + 1, last - 1) == 0)
+			return hay + i;
+		i++;
+	}
+	return NULL;
+}
+
+static const char *find_horspool(const t_matcher *m, const char *hay, size_t hay_len)
+{
+	const unsigned char *s = (const unsigned char *)hay;
+	size_t last = m->len - 1;
+	size_t i = 0;
+
+	while (i + last < hay_len)
+	{
+		unsigned char c = s[i + last];
+		if (c == m->pat[last] && memcmp(s + i, m->pat, last) == 0)
+			return hay + i;
+		i += m->shift[c];
+	}
+	return NULL;
+}
+
+// leftmost occurrence of the pattern fully inside hay[0..hay_len), or NULL
+const char *matcher_find(const t_matcher *m, const char *hay, size_t hay_len)
+{
+	if (m->kind == MATCH_BYTE)
+		return memchr(hay, m->pat[0], hay_len);
+	if (m->kind == MATCH_SHORT)
+		return find_short(m, hay, hay_len);
+	return find_horspool(m, hay, hay_len);
+}
+
+// TESTING: compares the matcher with filter.c's ft_strncmp() loop on random
+// inputs (small alphabets make matches and near-matches frequent).
+// Compile with: gcc matcher.c (after uncommenting)
+/* #include <stdio.h>
+#include <stdlib.h>
+
+int ft_strncmp(const char *s1, const char *s2, size_t n)
+{
+	size_t i = 0;
+	while (i < n && s1[i] == s2[i])
+		i++;
+	return i == n;
+}
+
+const char *naive_find(const char *search, size_t m, const char *hay, size_t n)
+{
+	for (size_t i = 0; i + m <= n; i++)
+		if (ft_strncmp(hay + i, search, m))
+			return hay + i;
+	return NULL;
+}
+
+int main(void)
+{
+	static char hay[5000];
+	static char search[200];
+	t_matcher m;
+
+	srand(42);
+	for (int round = 0; round < 200000; round++)
+	{
+		int alphabet = 1 + rand() % 4;
+		size_t n = rand() % sizeof(hay);
+		size_t len = 1 + rand() % (rand() % 2 ? 8 : sizeof(search));
+		for (size_t i = 0; i < n; i++)
+			hay[i] = 'a' + rand() % alphabet;
+		for (size_t i = 0; i < len; i++)
+			search[i] = 'a' + rand() % alphabet;
+		matcher_init(&m, search, len);
+		// walk the haystack like filter does: restart right after every match
+		size_t pos = 0;
+		while (1)
+		{
+			const char *expected = naive_find(search, len, hay + pos, n - pos);
+			const char *found = matcher_find(&m, hay + pos, n - pos);
+			if (found != expected)
+			{
+				printf("KO: round %d, length %zu, position %zu\n", round, len, pos);
+				return 1;
+			}
+			if (!found)
+				break ;
+			pos = found - hay + len;
+		}
+	}
+	printf("OK\n");
+	return 0;
+} */
@@ -0,0 +1,157 @@
+/* Streaming engine for filter: the whole input never has to fit in memory.
+
+filter.c reads stdin one byte per read() call into a fixed 10 000 byte buffer
+(anything after that is silently dropped) and writes one byte or one '*' per
+call. Here:
+- input is read in blocks of STREAM_BLOCK_SIZE bytes.
+- a match can start near the end of a block and finish in the next one, so
+the last (search_len - 1) bytes that cannot be decided yet are carried over
+to the front of the buffer before the next read: memory use is constant.
+- output goes through a t_writer buffer (common/writer.h): an unchanged span
+is copied with one memcpy and a masked run with one memset, and write() is only
+called when the buffer is full (or for spans larger than the buffer, which are
+written as-is).
+The t_iov_out helpers are the zero-copy counterpart of t_writer: the spans are
+not copied but handed to writev() (used by filter_mmap.c and filter_parallel.c).
+The replacement rules are the same as filter.c: left to right, and after a
+match the search continues right after it (matches never overlap). Matches
+are found with the matcher (see matcher.c). */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "filter.h"
+
+static char stars[STARS_SIZE];
+
+void iov_init(t_iov_out *out, int fd)
+{
+	out->fd = fd;
+	out->count = 0;
+	if (stars[0] != '*')
+		memset(stars, '*', STARS_SIZE);
+}
+
+// writev() the batch; a partial write restarts from the first unwritten byte
+int iov_flush(t_iov_out *out)
+{
+	struct iovec *iov = out->iov;
+	int count = out->count;
+	out->count = 0;
+	while (count > 0)
+	{
+		ssize_t written = writev(out->fd, iov, count);
+		if (written < 0)
+		{
+			if (errno == EINTR)
+				continue ;
+			return -1;
+		}
+		while (count > 0 && (size_t)written >= iov->iov_len)
+		{
+			written -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if (count > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+	return 0;
+}
+
+// append a span that must stay valid until the next iov_flush()
+int iov_add(t_iov_out *out, const char *s, size_t len)
+{
+	if (len == 0)
+		return 0;
+	if (out->count == IOV_BATCH && iov_flush(out) != 0)
+		return -1;
+	out->iov[out->count].iov_base = (void *)s;
+	out->iov[out->count].iov_len = len;
+	out->count++;
+	return 0;
+}
+
+int iov_add_stars(t_iov_out *out, size_t count)
+{
+	while (count > 0)
+	{
+		size_t n = count < STARS_SIZE ? count : STARS_SIZE;
+		if (iov_add(out, stars, n) != 0)
+			return -1;
+		count -= n;
+	}
+	return 0;
+}
+
+/* Copy in_fd to out_fd, replacing every occurrence of search by asterisks.
+Returns 0 on success, -1 on a read, write or malloc error (errno is set). */
+int filter_stream(int in_fd, int out_fd, const char *search, size_t search_len)
+{
+	t_writer *out = malloc(sizeof(t_writer)); // its buffer is inside: too big for the stack
+	t_matcher matcher;
+	matcher_init(&matcher, search, search_len);
+	// room for one block plus the carried-over bytes, whatever the pattern length
+	size_t cap = STREAM_BLOCK_SIZE + search_len;
+	char *buf = malloc(cap);
+	if (!buf || !out)
+	{
+		free(buf);
+		free(out);
+		return -1;
+	}
+	writer_init(out, out_fd);
+	size_t avail = 0; // bytes in buf (carried over + freshly read)
+	int eof = 0;
+	int ret = 0;
+	while (!eof)
+	{
+		ssize_t bytes = read(in_fd, buf + avail, cap - avail);
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue ;
+			ret = -1;
+			break ;
+		}
+		if (bytes == 0)
+			eof = 1;
+		avail += bytes;
+		// scan every position where a whole match still fits in the buffer;
+		// at EOF, the last bytes are just copied
+		size_t i = 0;
+		size_t span = 0; // start of the current unchanged span
+		while (i + search_len <= avail)
+		{
+			const char *match = matcher_find(&matcher, buf + i, avail - i);
+			if (!match)
+			{
+				// no match starts before the last (search_len - 1) bytes
+				i = avail - search_len + 1;
+				break ;
+			}
+			i = match - buf;
+			writer_bytes(out, buf + span, i - span);
+			writer_fill(out, '*', search_len);
+			i += search_len;
+			span = i;
+		}
+		if (eof)
+			i = avail;
+		writer_bytes(out, buf + span, i - span);
+		// carry the undecided tail (less than search_len bytes) to the front
+		memmove(buf, buf + i, avail - i);
+		avail -= i;
+	}
+	if (writer_flush(out) != 0)
+		ret = -1;
+	int saved_errno = errno;
+	free(out);
+	free(buf);
+	errno = saved_errno;
+	return ret;
+}
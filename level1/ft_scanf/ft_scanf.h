@@ -0,0 +1,73 @@
+#ifndef FT_SCANF_H
+#define FT_SCANF_H
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifndef FT_SCANF_BUFFER_SIZE
+#define FT_SCANF_BUFFER_SIZE (64 * 1024)
+#endif
+#define FT_SCANF_MAX_VIEWS 16 // %S conversions in one call
+
+enum e_source
+{
+	SOURCE_FILE,
+	SOURCE_FD,
+	SOURCE_MEMORY,
+};
+
+/* where the scan functions take their input from, with its read-ahead buffer
+(ft_scanf_buffered.c). Only created by the ft_scanner_*() functions; it is not
+opaque so that ft_scanner_memory() can return one by value, on the stack. */
+typedef struct s_scanner
+{
+	enum e_source		kind;
+	FILE				*file; // SOURCE_FILE
+	int					fd; // SOURCE_FD
+	char				*buf; // SOURCE_MEMORY: the caller's bytes, never written
+	size_t				pos; // next byte to scan
+	size_t				end; // number of bytes in buf
+	size_t				cap;
+	int					eof; // no more bytes will come
+	int					err; // ... because of a read error (ferror() locks f)
+	size_t				n_views; // %S views given by the current call
+	size_t				view_at[FT_SCANF_MAX_VIEWS]; // their offsets in buf
+	const char			**view_ptr[FT_SCANF_MAX_VIEWS]; // where they were stored
+	struct s_scanner	*next; // SOURCE_FILE: the other FILEs being read
+}	t_scanner;
+
+// a format translated once by ft_scanf_compile() (ft_scanf_buffered.c)
+typedef struct s_scanf_prog	t_scanf_prog;
+
+// a number read by %f / %lf: w * 10^q (ft_scanf_float.c)
+typedef struct s_decimal
+{
+	uint64_t	w; // the first 19 significant digits
+	int64_t		q;
+	int			negative;
+	int			truncated; // nonzero digits were dropped after w
+}	t_decimal;
+
+int		ft_scanf(const char *format, ...);
+int		ft_fscanf(FILE *f, const char *format, ...); // ft_scanf_buffered.c
+int		ft_vfscanf(FILE *f, const char *format, va_list ap);
+int		ft_sscanf(const char *str, const char *format, ...);
+void	ft_scanf_close(FILE *f); // ft_scanf_buffered.c
+t_scanner	*ft_scanner_file(FILE *f); // ft_scanf_buffered.c
+t_scanner	*ft_scanner_fd(int fd);
+t_scanner	ft_scanner_memory(const char *buf, size_t len);
+void	ft_scanner_free(t_scanner *src);
+int		ft_scanner_scanf(t_scanner *src, const char *format, ...);
+int		ft_vscanner_scanf(t_scanner *src, const char *format, va_list ap);
+t_scanf_prog	*ft_scanf_compile(const char *format); // ft_scanf_buffered.c
+void	ft_scanf_free(t_scanf_prog *prog);
+int		ft_scanf_exec(const t_scanf_prog *prog, t_scanner *src, ...);
+int		ft_vscanf_exec(const t_scanf_prog *prog, t_scanner *src, va_list ap);
+size_t	ft_scan_ints(t_scanner *src, int *out, size_t n); // ft_scanf_buffered.c
+// 1 if done, 0 if only strtod()/strtof() on the text can decide (ft_scanf_float.c)
+int		ft_decimal_to_double(const t_decimal *d, double *out);
+int		ft_decimal_to_float(const t_decimal *d, float *out);
+
+#endif
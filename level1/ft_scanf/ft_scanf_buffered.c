@@ -0,0 +1,1266 @@
+/* ft_scanf with its own input buffer. To be compiled in combination with
+ft_scanf.h and ft_scanf_float.c:
+	gcc ft_scanf_buffered.c ft_scanf_float.c
+
+ft_scanf.c calls fgetc() for every character and ungetc() for every
+character it only wanted to look at. Each of these calls locks the FILE and
+goes through a function call, which is most of the time spent on large
+inputs. Here the bytes of a FILE are fetched in blocks (one read() of up to
+FT_SCANF_BUFFER_SIZE bytes) into a t_scanner, and the scan functions work on
+the buffer directly: peeking is reading buf[pos], consuming is pos++, and
+"putting back" is not moving pos at all.
+
+The results are the same as ft_scanf.c (same return values, same characters
+consumed, a lone '+'/'-' before a non-digit is consumed too), except that a
+%d out of the range of int is clamped (errno = ERANGE) instead of wrapping
+around. %f (float *) and %lf (double *) are added: the number is read like
+strtof()/strtod() read it, with the same bits as result (ft_scanf_float.c).
+Bytes read ahead stay in the t_scanner of that FILE, not in the FILE itself,
+so a FILE read by ft_scanf() must not be read with other stdio functions as
+well. The scanner of a FILE is freed when it reaches EOF; ft_scanf_close(f)
+frees it earlier (before fclose(f) on a FILE that was not read to the end).
+A fetch never waits for more than the input that has already arrived: read()
+returns the line just typed on a terminal, or what the other side has written
+so far on a pipe or a socket (fread() would wait until the whole buffer is
+full, so "42\n" followed by a pause would block ft_scanf("%d") during the
+pause, and an interactive peer would never get its answer).
+
+A format that is used for millions of records can be translated once:
+
+	t_scanf_prog *prog = ft_scanf_compile("%d, %d\n");
+	t_scanner *src = ft_scanner_file(f); // see below
+	while (ft_scanf_exec(prog, src, &x, &y) == 2)
+		...
+	ft_scanf_free(prog);
+	ft_scanf_close(f);
+
+The program is an array of ops (skip whitespace, match a run of ordinary
+characters, %c, %d, %s, %S, %[...], %f, %lf), so each call goes straight to the
+scan functions. ft_vfscanf() translates its format into a few ops at a time on
+the stack and runs them with the same loop (run_ops()), so both give the same
+results.
+
+The input does not have to be a FILE. A t_scanner is one of:
+	ft_scanner_file(f)		the scanner ft_fscanf() uses for f (freed like it)
+	ft_scanner_fd(fd)		read() on fd, no stdio at all
+	ft_scanner_memory(buf, len)	len bytes already in memory, nothing allocated
+and ft_scanner_scanf(src, format, ...) / ft_scanf_exec(prog, src, ...) read
+from it. ft_sscanf(str, format, ...) is ft_scanner_scanf() on a memory
+scanner of str. Tokenizing a line held in memory (from get_next_line(), say)
+then needs neither fmemopen() nor any copy:
+
+	t_scanner	src = ft_scanner_memory(line, len);
+	const char	*name;
+	size_t		name_len;
+	ft_scanner_scanf(&src, "%S %d", &name, &name_len, &age);
+
+%S is %s without the copy: it stores a pointer to the word in the input and
+its length (const char **, size_t *); the word is NOT '\0'-terminated. In a
+memory scanner it points into the caller's bytes. Otherwise it points into the
+read-ahead buffer, and stays valid until the next call on that scanner (the
+buffer is then reused): that is why one call may give at most
+FT_SCANF_MAX_VIEWS of them (more is a matching failure). A width limits %s and
+%S, as in scanf(): "%15s" stores at most 15 characters (and the '\0') into a
+char[16], the rest of the word stays in the input.
+
+%[...] is the scanset of scanf() (char *, with an optional width): "%[^,]"
+reads everything up to a comma, "%[A-Za-z0-9_]" a word. The set is translated
+once into a bitmap of 256 bits, one per byte value, so matching a byte is one
+bit test however many characters and ranges the set has. */
+
+#include "ft_scanf.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+
+/* isspace() and isdigit() of the "C" locale, without the table look-up
+through __ctype_b_loc() that <ctype.h> does for every byte */
+#define IS_SPACE(c) ((c) == ' ' || ((unsigned)(c) - '\t' < 5))
+#define IS_DIGIT(c) ((unsigned)(c) - '0' < 10)
+// bytes that stdio has read ahead into f and not handed out yet (glibc; other
+// libcs: assumed none, so a stream without fd is fetched a byte at a time)
+#ifdef __GLIBC__
+# define FILE_PENDING(f) ((size_t)((f)->_IO_read_end - (f)->_IO_read_ptr))
+#else
+# define FILE_PENDING(f) ((size_t)0)
+#endif
+// what strtod() may read (inf, nan(...), 0x1p3): letters, digits, . + - ( ) _
+// bit c of a 256-bit scanset
+#define IN_SET(set, c) ((set)[(unsigned char)(c) >> 6] >> ((unsigned char)(c) & 63) & 1)
+#define IS_FLOAT_CHAR(c) (IS_DIGIT(c) || ((unsigned)(c) | 0x20) - 'a' < 26 \
+	|| (c) == '.' || (c) == '+' || (c) == '-' || (c) == '(' || (c) == ')' \
+	|| (c) == '_')
+
+#define INT_LIMIT 2147483648u // |INT_MIN|
+#define EXPONENT_LIMIT 100000000000000 // larger exponents are all the same
+#define FORMAT_OPS 16 // ops translated at a time by ft_vfscanf()
+
+enum e_scanf_op
+{
+	OP_SPACE, // whitespace in the format: skip whitespace in the input
+	OP_LITERAL, // ordinary characters that must match
+	OP_CHAR, // %c
+	OP_INT, // %d
+	OP_STRING, // %s
+	OP_VIEW, // %S
+	OP_SET, // %[...]
+	OP_FLOAT, // %f
+	OP_DOUBLE, // %lf
+	OP_FAIL, // unknown conversion: the scan stops there
+};
+
+typedef struct s_scanf_op
+{
+	enum e_scanf_op	kind;
+	size_t			len; // OP_LITERAL
+	const char		*lit;
+	size_t			width; // OP_STRING, OP_VIEW, OP_SET: SIZE_MAX if none
+	uint64_t		set[4]; // OP_SET: bit c is set if c is in the scanset
+	int				stop; // OP_SET: the only byte not in it ("%[^,]"), or -1
+}	t_scanf_op;
+
+struct s_scanf_prog
+{
+	size_t		count;
+	t_scanf_op	ops[]; // followed by the copy of the format
+};
+
+static t_scanner	*g_scanners = NULL; // one per FILE being read
+static const uint32_t	g_pow10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000,
+	10000000, 100000000};
+
+// a scanner with a buffer of its own, for f or fd (NULL if out of memory)
+static t_scanner	*new_scanner(enum e_source kind, FILE *f, int fd)
+{
+	t_scanner	*s = malloc(sizeof(t_scanner));
+
+	if (!s)
+		return NULL;
+	s->cap = FT_SCANF_BUFFER_SIZE;
+	s->buf = malloc(s->cap);
+	if (!s->buf)
+	{
+		free(s);
+		return NULL;
+	}
+	s->kind = kind;
+	s->file = f;
+	s->fd = fd;
+	s->pos = 0;
+	s->end = 0;
+	s->eof = 0;
+	s->err = 0;
+	s->n_views = 0;
+	s->next = NULL;
+	return s;
+}
+
+// the scanner of f, created if needed (NULL if out of memory)
+static t_scanner	*get_scanner(FILE *f)
+{
+	t_scanner	*s = g_scanners;
+
+	while (s && s->file != f)
+		s = s->next;
+	if (s)
+		return s;
+	s = new_scanner(SOURCE_FILE, f, fileno(f)); // -1 for fmemopen() streams
+	if (!s)
+		return NULL;
+	s->next = g_scanners;
+	g_scanners = s;
+	return s;
+}
+
+/*
+ * ft_scanner_file: The scanner ft_fscanf(f, ...) reads from, so both can be
+ * used on f. It is freed by ft_scanf_close(f) (or ft_scanner_free()), or when
+ * an ft_fscanf() call on f reaches the end of the input.
+ * Returns: the scanner, NULL if out of memory.
+ */
+t_scanner	*ft_scanner_file(FILE *f)
+{
+	return get_scanner(f);
+}
+
+/*
+ * ft_scanner_fd: A scanner that reads fd with read(), for the caller alone.
+ * fd is not closed by ft_scanner_free().
+ * Returns: the scanner, NULL if out of memory.
+ */
+t_scanner	*ft_scanner_fd(int fd)
+{
+	return new_scanner(SOURCE_FD, NULL, fd);
+}
+
+/*
+ * ft_scanner_memory: A scanner of the len bytes at buf, which must stay there
+ * while it is used. Nothing is allocated, nor copied: the bytes are the
+ * buffer, and they are all there from the start (eof is already set).
+ * Returns: the scanner, by value (ft_scanner_free() is not needed).
+ */
+t_scanner	ft_scanner_memory(const char *buf, size_t len)
+{
+	t_scanner	s;
+
+	s.kind = SOURCE_MEMORY;
+	s.file = NULL;
+	s.fd = -1;
+	s.buf = (char *)(buf ? buf : ""); // only ever read
+	s.pos = 0;
+	s.end = buf ? len : 0;
+	s.cap = s.end;
+	s.eof = 1;
+	s.err = 0;
+	s.n_views = 0;
+	s.next = NULL;
+	return s;
+}
+
+void	ft_scanf_close(FILE *f)
+{
+	t_scanner	**link = &g_scanners;
+	t_scanner	*s;
+
+	while (*link && (*link)->file != f)
+		link = &(*link)->next;
+	if (!*link)
+		return ;
+	s = *link;
+	*link = s->next;
+	free(s->buf);
+	free(s);
+}
+
+void	ft_scanner_free(t_scanner *src)
+{
+	if (!src)
+		return ;
+	if (src->kind == SOURCE_FILE)
+		ft_scanf_close(src->file);
+	else if (src->kind == SOURCE_FD)
+	{
+		free(src->buf);
+		free(src);
+	}
+}
+
+// one read() into the free end of buf, returning what has arrived; -1 on error
+static ssize_t	read_some(t_scanner *s, int fd)
+{
+	ssize_t	bytes;
+
+	while ((bytes = read(fd, s->buf + s->end, s->cap - s->end)) < 0
+		&& errno == EINTR)
+		;
+	return bytes;
+}
+
+/* what f can give without waiting for more input: one read() on its fd,
+unless stdio holds bytes of f already (f was read before, or has no fd, like
+fmemopen() streams): then one getc(), which only waits if nothing at all has
+arrived, and the rest of what stdio holds (FILE_PENDING()). s->err is set on
+a read error. */
+static size_t	fetch_file(t_scanner *s)
+{
+	size_t	n = 0;
+	ssize_t	bytes;
+	int		c;
+
+	flockfile(s->file);
+	if (s->fd >= 0 && FILE_PENDING(s->file) == 0)
+	{
+		bytes = read_some(s, s->fd);
+		s->err = bytes < 0;
+		n = bytes > 0 ? bytes : 0;
+	}
+	else if ((c = getc_unlocked(s->file)) != EOF)
+	{
+		s->buf[s->end + n++] = c;
+		while (s->end + n < s->cap && FILE_PENDING(s->file) > 0)
+			s->buf[s->end + n++] = getc_unlocked(s->file);
+	}
+	else
+		s->err = ferror_unlocked(s->file) != 0;
+	funlockfile(s->file);
+	return n;
+}
+
+// appends the next block of input after end; 0 at EOF or on error (s->err
+// tells which)
+static int	fetch(t_scanner *s)
+{
+	size_t	n;
+	ssize_t	bytes;
+
+	if (s->eof)
+		return 0;
+	if (s->kind == SOURCE_FD)
+	{
+		bytes = read_some(s, s->fd);
+		s->err = bytes < 0;
+		n = bytes > 0 ? bytes : 0;
+	}
+	else
+		n = fetch_file(s);
+	s->end += n;
+	if (n == 0)
+		s->eof = 1;
+	return n > 0;
+}
+
+/* more input, without losing the bytes from pos to end that are not
+consumed yet: they are moved to the front of the buffer (and the buffer is
+doubled if they fill it), so a token being looked at stays in one piece. The
+%S views of the current call are kept as well (they come before pos), and the
+pointers given to the caller are moved with them. Out of memory is reported
+like a read error. */
+static int	more(t_scanner *s)
+{
+	size_t	keep = s->n_views > 0 ? s->view_at[0] : s->pos;
+	char	*buf;
+	size_t	i;
+
+	if (s->eof)
+		return 0;
+	if (keep > 0)
+	{
+		memmove(s->buf, s->buf + keep, s->end - keep);
+		s->end -= keep;
+		s->pos -= keep;
+		for (i = 0; i < s->n_views; i++)
+			s->view_at[i] -= keep;
+	}
+	if (s->end == s->cap)
+	{
+		buf = realloc(s->buf, 2 * s->cap);
+		if (!buf)
+		{
+			s->eof = 1;
+			s->err = 1;
+			return 0;
+		}
+		s->buf = buf;
+		s->cap *= 2;
+	}
+	for (i = 0; i < s->n_views; i++)
+		*s->view_ptr[i] = s->buf + s->view_at[i];
+	return fetch(s);
+}
+
+// everything has been scanned: the next block of input, from buf[0]
+static int	refill(t_scanner *s)
+{
+	if (s->eof)
+		return 0;
+	if (s->n_views > 0) // the bytes of the %S views must not be overwritten
+		return more(s);
+	s->pos = 0;
+	s->end = 0;
+	return fetch(s);
+}
+
+// the byte i places after pos, without consuming anything, or EOF
+static inline int	look(t_scanner *s, size_t i)
+{
+	while (s->pos + i >= s->end)
+		if (!more(s))
+			return EOF;
+	return (unsigned char)s->buf[s->pos + i];
+}
+
+// the next byte without consuming it, or EOF
+static inline int	peek(t_scanner *s)
+{
+	if (s->pos == s->end && !refill(s))
+		return EOF;
+	return (unsigned char)s->buf[s->pos];
+}
+
+/*
+ * match_space: Consumes leading whitespace characters from the input.
+ * Returns: 0 on success (whitespace consumed or no whitespace found),
+ * -1 if a read error occurs.
+ */
+static int	match_space(t_scanner *s)
+{
+	int	c;
+
+	while ((c = peek(s)) != EOF && IS_SPACE(c))
+		s->pos++;
+	if (s->err)
+		return -1;
+	return 0;
+}
+
+/*
+ * scan_char: Stores the next character (whitespace included) into the
+ * char * taken from ap.
+ * Returns: 1 on success, 0 at EOF, -1 if a read error occurs.
+ */
+static int	scan_char(t_scanner *s, va_list ap)
+{
+	int	c = peek(s);
+
+	if (c == EOF)
+		return s->err ? -1 : 0;
+	s->pos++;
+	*va_arg(ap, char *) = (char)c;
+	return 1;
+}
+
+// how many of the 8 bytes of v (first byte = lowest) are digits before the
+// first non-digit
+static inline int	count_digits8(uint64_t v)
+{
+	uint64_t	x = v ^ 0x3030303030303030; // digits become bytes 0..9
+	// bit 7 of a byte is set if it was >= 10 (0x76 + 10 = 0x80) or >= 0x80
+	uint64_t	mask = (((x & 0x7F7F7F7F7F7F7F7F) + 0x7676767676767676) | x)
+		& 0x8080808080808080;
+
+	return mask ? __builtin_ctzll(mask) / 8 : 8;
+}
+
+// the value of the first n digits of v (1 <= n <= 8), three multiplications
+// instead of n: pairs of digits, then groups of 4, then all 8
+static inline uint32_t	parse_digits8(uint64_t v, int n)
+{
+	v = (v & 0x0F0F0F0F0F0F0F0F) << (8 * (8 - n)); // leading zeros
+	v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FF;
+	v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFF;
+	return (uint32_t)(v * 10000 + (v >> 32));
+}
+
+/*
+ * read_int: Reads an optionally signed decimal integer into *out. Like
+ * ft_scanf.c, the sign is consumed even when no digit follows. Digits are
+ * taken 8 at a time while 8 bytes are buffered (SWAR: the 8 bytes are loaded
+ * as one 64-bit word, checked and converted with a few word operations). A
+ * value outside the range of int is clamped to INT_MIN/INT_MAX and errno is
+ * set to ERANGE, like strtol().
+ * Returns: 1 on success, 0 if there is no digit, -1 if a read error occurs.
+ */
+static inline int	read_int(t_scanner *s, int *out)
+{
+	int						c = peek(s);
+	int						negative = 0;
+	uint64_t				value = 0; // clamped to INT_LIMIT + 1
+	int						digits_read = 0;
+	int						done = 0;
+	uint64_t				v;
+	int						n;
+
+	if (c == EOF)
+		return s->err ? -1 : 0;
+	if (c == '+' || c == '-')
+	{
+		negative = c == '-';
+		s->pos++;
+	}
+	while (!done)
+	{
+		while (!done && s->end - s->pos >= 8)
+		{
+			memcpy(&v, s->buf + s->pos, 8);
+			n = count_digits8(v);
+			if (n > 0)
+			{
+				value = value * g_pow10[n] + parse_digits8(v, n);
+				if (value > INT_LIMIT)
+					value = INT_LIMIT + 1;
+				s->pos += n;
+				digits_read += n;
+			}
+			done = n < 8;
+		}
+		// fewer than 8 bytes left in the buffer: one at a time
+		while (!done && s->pos < s->end)
+		{
+			c = (unsigned char)s->buf[s->pos];
+			if (!IS_DIGIT(c))
+				done = 1;
+			else
+			{
+				value = value * 10 + (c - '0');
+				if (value > INT_LIMIT)
+					value = INT_LIMIT + 1;
+				s->pos++;
+				digits_read++;
+			}
+		}
+		if (!done && !refill(s))
+			break ;
+	}
+	if (s->err)
+		return -1;
+	if (digits_read == 0)
+		return 0;
+	if (value > (negative ? INT_LIMIT : INT_LIMIT - 1))
+	{
+		errno = ERANGE;
+		*out = negative ? INT_MIN : INT_MAX;
+	}
+	else
+		*out = negative ? -(int64_t)value : (int64_t)value;
+	return 1;
+}
+
+/*
+ * scan_int: Reads an integer (see read_int()) into the int * taken from ap.
+ * Returns: 1 on success, 0 if there is no digit, -1 if a read error occurs.
+ */
+static int	scan_int(t_scanner *s, va_list ap)
+{
+	int	value;
+	int	ret = read_int(s, &value);
+
+	if (ret == 1)
+		*va_arg(ap, int *) = value;
+	return ret;
+}
+
+/*
+ * strto_fallback: Converts with strtod()/strtof() what they accept at pos:
+ * inf, nan, hexadecimal, and the rare decimal that ft_decimal_to_double()
+ * cannot round alone. The text is copied first since buf has no '\0'.
+ * Returns: 1 on success, 0 if there is no number, -1 if out of memory.
+ */
+static int	strto_fallback(t_scanner *s, int is_double, void *out)
+{
+	char	small[128];
+	char	*text = small;
+	size_t	cap = sizeof(small);
+	size_t	len = 0;
+	char	*end;
+	int		c;
+
+	while ((c = look(s, len)) != EOF && IS_FLOAT_CHAR(c))
+	{
+		if (len + 1 == cap)
+		{
+			char *bigger = malloc(2 * cap);
+			if (!bigger)
+			{
+				if (text != small)
+					free(text);
+				return -1;
+			}
+			memcpy(bigger, text, len);
+			if (text != small)
+				free(text);
+			text = bigger;
+			cap *= 2;
+		}
+		text[len++] = c;
+	}
+	text[len] = '\0';
+	if (is_double)
+		*(double *)out = strtod(text, &end);
+	else
+		*(float *)out = strtof(text, &end);
+	s->pos += end - text;
+	if (text != small)
+		free(text);
+	if (s->err)
+		return -1;
+	return end > text;
+}
+
+// one more digit of the mantissa (in_fraction: after the '.') into d
+static inline void	add_digit(t_decimal *d, int c, int *digits, int in_fraction)
+{
+	if (*digits == 0 && c == '0') // leading zero
+		d->q -= in_fraction;
+	else if (*digits < 19)
+	{
+		d->w = d->w * 10 + (c - '0');
+		(*digits)++;
+		d->q -= in_fraction;
+	}
+	else
+	{
+		// no room left in w: only the magnitude counts
+		d->truncated |= c != '0';
+		d->q += !in_fraction;
+	}
+}
+
+/* the digits from pos + i on into d; returns the index after them. Up to 8
+digits at a time (see read_int()) as long as they are all significant and fit
+in w, one at a time otherwise. */
+static inline size_t	read_digits(t_scanner *s, size_t i, t_decimal *d,
+	int *digits, int in_fraction)
+{
+	uint64_t	v;
+	int			n;
+	int			c;
+
+	while (1)
+	{
+		if (s->end - s->pos - i >= 8)
+		{
+			memcpy(&v, s->buf + s->pos + i, 8);
+			n = count_digits8(v);
+			if (n == 0)
+				return i;
+			if (*digits + n <= 19 && (*digits > 0 || (v & 0xFF) != '0'))
+			{
+				d->w = d->w * g_pow10[n] + parse_digits8(v, n);
+				*digits += n;
+				d->q -= in_fraction * n;
+				i += n;
+				if (n < 8)
+					return i;
+				continue ;
+			}
+		}
+		c = look(s, i);
+		if (!IS_DIGIT(c))
+			return i;
+		add_digit(d, c, digits, in_fraction);
+		i++;
+	}
+}
+
+/*
+ * read_float: Reads a floating-point number into *out (a float or a double),
+ * with the same result and length as strtod()/strtof(): sign, digits with an
+ * optional '.', optional exponent. The number is looked at with look() and
+ * only consumed once it is complete, so nothing is consumed when there is no
+ * number, and "1e+" is read as 1 (the "e+" stays). The digits go into a
+ * t_decimal for ft_decimal_to_double() / ft_decimal_to_float().
+ * Returns: 1 on success, 0 if there is no number, -1 if a read error occurs
+ * or if the input ends before the number (an input failure, as scanf() calls
+ * it: see run_ops()).
+ */
+static int	read_float(t_scanner *s, int is_double, void *out)
+{
+	t_decimal	d = {0, 0, 0, 0};
+	size_t		i = 0;
+	int			digits = 0; // significant digits in w
+	int			any = 0; // at least one digit in the mantissa
+	int			c = look(s, 0);
+	int64_t		exp = 0;
+	int			exp_negative = 0;
+	size_t		j;
+
+	if (c == '+' || c == '-')
+	{
+		d.negative = c == '-';
+		c = look(s, ++i);
+	}
+	if ((c | 0x20) == 'i' || (c | 0x20) == 'n'
+		|| (c == '0' && (look(s, i + 1) | 0x20) == 'x'))
+		return strto_fallback(s, is_double, out);
+	j = read_digits(s, i, &d, &digits, 0);
+	any = j > i;
+	i = j;
+	if (look(s, i) == '.')
+	{
+		j = read_digits(s, i + 1, &d, &digits, 1);
+		any |= j > i + 1;
+		i = j;
+	}
+	c = look(s, i);
+	if (!any)
+		return s->err || look(s, 0) == EOF ? -1 : 0;
+	if ((c | 0x20) == 'e')
+	{
+		j = i + 1;
+		c = look(s, j);
+		if (c == '+' || c == '-')
+		{
+			exp_negative = c == '-';
+			c = look(s, ++j);
+		}
+		if (IS_DIGIT(c)) // else the 'e' is not part of the number
+		{
+			while (IS_DIGIT(c))
+			{
+				if (exp < EXPONENT_LIMIT)
+					exp = exp * 10 + (c - '0');
+				c = look(s, ++j);
+			}
+			i = j;
+		}
+	}
+	if (s->err)
+		return -1;
+	d.q += exp_negative ? -exp : exp;
+	if (!(is_double ? ft_decimal_to_double(&d, out) : ft_decimal_to_float(&d, out)))
+		return strto_fallback(s, is_double, out);
+	s->pos += i;
+	return 1;
+}
+
+/*
+ * scan_float: Reads a number (see read_float()) into the float * (%f) or the
+ * double * (%lf) taken from ap.
+ * Returns: 1 on success, 0 if there is no number, -1 at EOF or on error.
+ */
+static int	scan_float(t_scanner *s, va_list ap, int is_double)
+{
+	double	value_d;
+	float	value_f;
+	int		ret;
+
+	ret = read_float(s, is_double, is_double ? (void *)&value_d : (void *)&value_f);
+	if (ret == 1 && is_double)
+		*va_arg(ap, double *) = value_d;
+	else if (ret == 1)
+		*va_arg(ap, float *) = value_f;
+	return ret;
+}
+
+/*
+ * scan_string: Copies the next run of non-whitespace characters (at most
+ * width of them) into the char * taken from ap, and '\0'-terminates it.
+ * Returns: 1 on success, 0 at EOF, -1 if a read error occurs.
+ */
+static int	scan_string(t_scanner *s, size_t width, va_list ap)
+{
+	char	*str;
+	int		char_read = 0;
+
+	if (peek(s) == EOF)
+		return s->err ? -1 : 0;
+	str = va_arg(ap, char *);
+	while (1)
+	{
+		while (s->pos < s->end && width > 0
+			&& !IS_SPACE((unsigned char)s->buf[s->pos]))
+		{
+			*str++ = s->buf[s->pos++];
+			char_read = 1;
+			width--;
+		}
+		if (s->pos < s->end || width == 0 || !refill(s))
+			break ;
+	}
+	if (s->err)
+		return -1;
+	if (!char_read)
+		return 0;
+	*str = '\0';
+	return 1;
+}
+
+/*
+ * scan_view: Finds the next run of non-whitespace characters (at most width
+ * of them) and stores where it starts into the const char ** taken from ap
+ * and its length into the size_t *, without copying it. The run is looked at
+ * with look(), so it is in one piece in the buffer. Unless the scanner is a
+ * memory one (whose buffer never moves), the view is recorded so that more()
+ * can keep its bytes and move the pointer, until the end of the call.
+ * Returns: 1 on success, 0 at EOF or if FT_SCANF_MAX_VIEWS views were given
+ * already, -1 if a read error occurs.
+ */
+static int	scan_view(t_scanner *s, size_t width, va_list ap)
+{
+	const char	**ptr;
+	size_t		len = 0;
+	int			c;
+
+	if (peek(s) == EOF)
+		return s->err ? -1 : 0;
+	while (len < width && (c = look(s, len)) != EOF && !IS_SPACE(c))
+		len++;
+	if (s->err)
+		return -1;
+	if (len == 0 || (s->kind != SOURCE_MEMORY
+			&& s->n_views == FT_SCANF_MAX_VIEWS))
+		return 0;
+	ptr = va_arg(ap, const char **);
+	*ptr = s->buf + s->pos;
+	*va_arg(ap, size_t *) = len;
+	if (s->kind != SOURCE_MEMORY)
+	{
+		s->view_at[s->n_views] = s->pos;
+		s->view_ptr[s->n_views++] = ptr;
+	}
+	s->pos += len;
+	return 1;
+}
+
+/* how many of the n bytes at p are in the scanset of op before the first one
+that is not. A set of all bytes but one ("%[^,]", "%[^\n]": the usual fields)
+is a memchr() for that byte, which libc does 16 or 32 bytes at a time. Other
+sets are tested eight bytes at a time: their eight bit tests make one mask, so
+there is one branch per 8 bytes instead of one per byte (the end of a field is
+a branch that the CPU cannot predict). */
+static inline size_t	span_set(const t_scanf_op *op, const unsigned char *p,
+	size_t n)
+{
+	const uint64_t	*set = op->set;
+	const void		*stop;
+	size_t			i = 0;
+	unsigned		mask;
+	int				k;
+
+	if (op->stop >= 0)
+	{
+		stop = memchr(p, op->stop, n);
+		return stop ? (size_t)((const unsigned char *)stop - p) : n;
+	}
+	while (i + 8 <= n)
+	{
+		mask = 0;
+		for (k = 0; k < 8; k++)
+			mask |= (unsigned)IN_SET(set, p[i + k]) << k;
+		if (mask != 0xFF)
+			return i + __builtin_ctz(~mask);
+		i += 8;
+	}
+	while (i < n && IN_SET(set, p[i]))
+		i++;
+	return i;
+}
+
+/*
+ * scan_set: Copies the next run of characters that are in the scanset (at
+ * most width of them) into the char * taken from ap, and '\0'-terminates it.
+ * Whitespace is not skipped first. The run is measured in the buffer with
+ * span_set(), then copied with one memcpy().
+ * Returns: 1 on success, 0 if the first character is not in the set,
+ * -1 at EOF or on error (an input failure, see run_ops()).
+ */
+static int	scan_set(t_scanner *s, const t_scanf_op *op, va_list ap)
+{
+	char	*str;
+	size_t	width = op->width;
+	size_t	total = 0;
+	size_t	n;
+	size_t	i;
+
+	if (peek(s) == EOF)
+		return -1;
+	str = va_arg(ap, char *);
+	while (width > 0)
+	{
+		n = s->end - s->pos < width ? s->end - s->pos : width;
+		i = span_set(op, (const unsigned char *)s->buf + s->pos, n);
+		memcpy(str + total, s->buf + s->pos, i);
+		total += i;
+		s->pos += i;
+		width -= i;
+		if (i < n || width == 0 || !refill(s))
+			break ;
+	}
+	if (s->err)
+		return -1;
+	if (total == 0)
+		return 0;
+	str[total] = '\0';
+	return 1;
+}
+
+/*
+ * match_literal: Consumes the len characters of lit, one at a time, while
+ * they match (like len calls to match_char() in ft_scanf.c).
+ * Returns: 1 if all of them match, 0 if one does not (or at EOF),
+ * -1 if a read error occurs.
+ */
+static int	match_literal(t_scanner *s, const char *lit, size_t len)
+{
+	size_t	i = 0;
+
+	while (i < len)
+	{
+		if (s->pos == s->end && !refill(s))
+			return s->err ? -1 : 0;
+		if (s->buf[s->pos] != lit[i])
+			return 0;
+		s->pos++;
+		i++;
+	}
+	return 1;
+}
+
+/*
+ * compile_set: Translates the scanset that starts after the '[' at f into the
+ * bitmap of op. A '^' first inverts it, a ']' first is a member, and "a-z" is
+ * the range from 'a' to 'z'; like glibc, a '-' first, last, or between two
+ * characters in the wrong order is a member itself.
+ * Returns: the closing ']', NULL if there is none (the conversion is invalid).
+ */
+static const char	*compile_set(const char *f, t_scanf_op *op)
+{
+	int			invert = *f == '^';
+	const char	*first;
+	int			c;
+
+	memset(op->set, 0, sizeof(op->set));
+	f += invert;
+	first = f;
+	while (*f && (*f != ']' || f == first))
+	{
+		if (*f == '-' && f > first && f[1] && f[1] != ']'
+			&& (unsigned char)f[-1] <= (unsigned char)f[1])
+		{
+			for (c = (unsigned char)f[-1]; c <= (unsigned char)f[1]; c++)
+				op->set[c >> 6] |= (uint64_t)1 << (c & 63);
+			f += 2;
+			continue ;
+		}
+		c = (unsigned char)*f++;
+		op->set[c >> 6] |= (uint64_t)1 << (c & 63);
+	}
+	if (!*f)
+		return NULL;
+	if (invert)
+		for (c = 0; c < 4; c++)
+			op->set[c] = ~op->set[c];
+	op->stop = -1;
+	if (__builtin_popcountll(op->set[0]) + __builtin_popcountll(op->set[1])
+		+ __builtin_popcountll(op->set[2]) + __builtin_popcountll(op->set[3]) == 255)
+	{
+		op->stop = 0;
+		while (IN_SET(op->set, op->stop))
+			op->stop++;
+	}
+	return f;
+}
+
+/*
+ * compile_ops: Translates the format at *format into at most max ops, and
+ * moves *format past what was translated. Whitespace runs become one
+ * OP_SPACE (match_space() twice in a row is the same as once), runs of
+ * ordinary characters one OP_LITERAL pointing into the format itself.
+ * An unknown conversion (or a '%' at the end, a width on anything but %s, %S
+ * and %[, a '[' without its ']') becomes OP_FAIL, and nothing after it is
+ * translated since it could never be reached.
+ * Returns: the number of ops written.
+ */
+static size_t	compile_ops(const char **format, t_scanf_op *ops, size_t max)
+{
+	const char	*f = *format;
+	size_t		n = 0;
+	const char	*set_end;
+
+	while (*f && n < max)
+	{
+		t_scanf_op *op = &ops[n++];
+		if (*f == '%')
+		{
+			f++;
+			op->width = 0;
+			while (IS_DIGIT(*f))
+			{
+				op->width = op->width < SIZE_MAX / 10
+					? op->width * 10 + (*f - '0') : SIZE_MAX;
+				f++;
+			}
+			if (op->width == 0) // "%0s" has no limit either, like glibc
+				op->width = SIZE_MAX;
+			op->kind = OP_FAIL;
+			if (op->width != SIZE_MAX && *f != 's' && *f != 'S' && *f != '[')
+				; // a width is only for %s, %S and %[
+			else if (*f == 'c')
+				op->kind = OP_CHAR;
+			else if (*f == 'd')
+				op->kind = OP_INT;
+			else if (*f == 's')
+				op->kind = OP_STRING;
+			else if (*f == 'S')
+				op->kind = OP_VIEW;
+			else if (*f == '[' && (set_end = compile_set(f + 1, op)) != NULL)
+			{
+				op->kind = OP_SET;
+				f = set_end; // on the ']'
+			}
+			else if (*f == 'f')
+				op->kind = OP_FLOAT;
+			else if (*f == 'l' && f[1] == 'f')
+			{
+				op->kind = OP_DOUBLE;
+				f++;
+			}
+			if (op->kind == OP_FAIL)
+			{
+				f += *f != '\0';
+				break ;
+			}
+			f++;
+		}
+		else if (IS_SPACE((unsigned char)*f))
+		{
+			op->kind = OP_SPACE;
+			while (IS_SPACE((unsigned char)*f))
+				f++;
+		}
+		else
+		{
+			op->kind = OP_LITERAL;
+			op->lit = f;
+			while (*f && *f != '%' && !IS_SPACE((unsigned char)*f))
+				f++;
+			op->len = f - op->lit;
+		}
+	}
+	if (n > 0 && ops[n - 1].kind == OP_FAIL)
+		f += strlen(f); // the rest is unreachable
+	*format = f;
+	return n;
+}
+
+/*
+ * run_ops: THE dispatch loop, shared by ft_vfscanf() and ft_scanf_exec().
+ * Runs n ops and adds the items assigned to *nconv.
+ * Returns: 1 if all ops succeeded, 0 if one stopped the scan, EOF if %f, %lf
+ * or %[ stopped it because the input ended. Like scanf(), the call then returns EOF
+ * if nothing was assigned yet (%c, %d and %s keep the behaviour of
+ * ft_scanf.c, which returns 0 there).
+ */
+static int	run_ops(t_scanner *s, const t_scanf_op *ops, size_t n, va_list ap,
+	int *nconv)
+{
+	size_t	i = 0;
+	int		ret;
+
+	while (i < n)
+	{
+		switch (ops[i].kind)
+		{
+			case OP_SPACE:
+				ret = match_space(s) == -1 ? -1 : 1;
+				break ;
+			case OP_LITERAL:
+				ret = match_literal(s, ops[i].lit, ops[i].len);
+				break ;
+			case OP_CHAR:
+				ret = scan_char(s, ap);
+				*nconv += ret == 1;
+				break ;
+			case OP_INT:
+				match_space(s);
+				ret = scan_int(s, ap);
+				*nconv += ret == 1;
+				break ;
+			case OP_STRING:
+				match_space(s);
+				ret = scan_string(s, ops[i].width, ap);
+				*nconv += ret == 1;
+				break ;
+			case OP_VIEW:
+				match_space(s);
+				ret = scan_view(s, ops[i].width, ap);
+				*nconv += ret == 1;
+				break ;
+			case OP_SET:
+				ret = scan_set(s, &ops[i], ap);
+				if (ret == -1)
+					return EOF;
+				*nconv += ret == 1;
+				break ;
+			case OP_FLOAT:
+			case OP_DOUBLE:
+				match_space(s);
+				ret = scan_float(s, ap, ops[i].kind == OP_DOUBLE);
+				if (ret == -1)
+					return EOF;
+				*nconv += ret == 1;
+				break ;
+			default:
+				ret = -1;
+		}
+		if (ret != 1)
+			return 0;
+		i++;
+	}
+	return 1;
+}
+
+// the part common to all the scanf functions (format: see ft_vfscanf())
+static int	scan_with(t_scanner *s, const t_scanf_prog *prog, const char *format,
+	va_list ap)
+{
+	t_scanf_op	ops[FORMAT_OPS];
+	size_t		n;
+	int			nconv = 0;
+	int			ret = 1;
+
+	if (!s)
+		return EOF;
+	s->n_views = 0; // the views of the previous call are given up
+	if (peek(s) == EOF)
+		return EOF;
+	if (prog)
+		ret = run_ops(s, prog->ops, prog->count, ap, &nconv);
+	else
+	{
+		// translate and run FORMAT_OPS ops at a time: no allocation
+		while ((n = compile_ops(&format, ops, FORMAT_OPS)) > 0)
+			if ((ret = run_ops(s, ops, n, ap, &nconv)) != 1)
+				break ;
+	}
+	if (s->err || (ret == EOF && nconv == 0))
+		nconv = EOF;
+	return nconv;
+}
+
+/*
+ * ft_vfscanf: Parses format and reads from f, like vfscanf.
+ * Returns: the number of items assigned,
+ * EOF if the input ends (or fails) before anything is read.
+ */
+int	ft_vfscanf(FILE *f, const char *format, va_list ap)
+{
+	t_scanner	*s = get_scanner(f);
+	int			ret = scan_with(s, NULL, format, ap);
+
+	// nothing left to keep for f, unless %S views still point into its buffer
+	// (then the next call finds the end and frees it)
+	if (s && s->eof && s->pos == s->end && s->n_views == 0)
+		ft_scanf_close(f);
+	return ret;
+}
+
+int	ft_vscanner_scanf(t_scanner *src, const char *format, va_list ap)
+{
+	return scan_with(src, NULL, format, ap);
+}
+
+/*
+ * ft_scanner_scanf: Same as ft_fscanf(), reading from src (see
+ * ft_scanner_file(), ft_scanner_fd(), ft_scanner_memory()). src is never
+ * freed here, not even at the end of the input.
+ */
+int	ft_scanner_scanf(t_scanner *src, const char *format, ...)
+{
+	va_list	ap;
+	int		ret;
+
+	va_start(ap, format);
+	ret = ft_vscanner_scanf(src, format, ap);
+	va_end(ap);
+	return ret;
+}
+
+/*
+ * ft_sscanf: Parses format and reads from the string str, like sscanf, with
+ * a memory scanner on the stack: nothing is allocated, and %S views point
+ * into str.
+ */
+int	ft_sscanf(const char *str, const char *format, ...)
+{
+	t_scanner	src = ft_scanner_memory(str, strlen(str));
+	va_list		ap;
+	int			ret;
+
+	va_start(ap, format);
+	ret = scan_with(&src, NULL, format, ap);
+	va_end(ap);
+	return ret;
+}
+
+/*
+ * ft_scanf_compile: Translates format once, for ft_scanf_exec().
+ * Returns: the program (free it with ft_scanf_free()), NULL if out of memory.
+ */
+t_scanf_prog	*ft_scanf_compile(const char *format)
+{
+	t_scanf_op		ops[FORMAT_OPS];
+	const char		*f = format;
+	size_t			count = 0;
+	size_t			n;
+	size_t			len = strlen(format);
+	t_scanf_prog	*prog;
+	char			*copy;
+
+	// first pass: count the ops
+	while ((n = compile_ops(&f, ops, FORMAT_OPS)) > 0)
+		count += n;
+	// the program, then its ops, then a copy of format for the literals
+	prog = malloc(sizeof(t_scanf_prog) + count * sizeof(t_scanf_op) + len + 1);
+	if (!prog)
+		return NULL;
+	copy = (char *)(prog->ops + count);
+	memcpy(copy, format, len + 1);
+	f = copy;
+	prog->count = compile_ops(&f, prog->ops, count);
+	return prog;
+}
+
+void	ft_scanf_free(t_scanf_prog *prog)
+{
+	free(prog);
+}
+
+int	ft_vscanf_exec(const t_scanf_prog *prog, t_scanner *src, va_list ap)
+{
+	return scan_with(src, prog, NULL, ap);
+}
+
+/*
+ * ft_scanf_exec: Same as ft_scanner_scanf(src, format, ...), where prog is
+ * ft_scanf_compile(format), without translating format again.
+ */
+int	ft_scanf_exec(const t_scanf_prog *prog, t_scanner *src, ...)
+{
+	va_list	ap;
+	int		ret;
+
+	va_start(ap, src);
+	ret = ft_vscanf_exec(prog, src, ap);
+	va_end(ap);
+	return ret;
+}
+
+/*
+ * ft_scan_ints: Reads up to n whitespace-separated integers from src into
+ * out, in one loop (no format, no va_list). Stops early at EOF or at the
+ * first thing that is not an integer; out-of-range values are clamped as in %d.
+ * Returns: the number of integers stored (src->err tells a read error).
+ */
+size_t	ft_scan_ints(t_scanner *src, int *out, size_t n)
+{
+	size_t	i = 0;
+
+	if (!src)
+		return 0;
+	src->n_views = 0;
+	while (i < n && match_space(src) == 0 && read_int(src, out + i) == 1)
+		i++;
+	return i;
+}
+
+int	ft_fscanf(FILE *f, const char *format, ...)
+{
+	va_list	ap;
+	int		ret;
+
+	va_start(ap, format);
+	ret = ft_vfscanf(f, format, ap);
+	va_end(ap);
+	return ret;
+}
+
+int	ft_scanf(const char *format, ...)
+{
+	va_list	ap;
+	int		ret;
+
+	va_start(ap, format);
+	ret = ft_vfscanf(stdin, format, ap);
+	va_end(ap);
+	return ret;
+}
+
+// TESTING: sums the numbers read from stdin
+/* int main(void)
+{
+	int		number;
+	long	sum = 0;
+	int		count = 0;
+
+	while (ft_scanf("%d", &number) == 1)
+	{
+		sum += number;
+		count++;
+	}
+	printf("%d numbers, sum %ld\n", count, sum);
+	return (0);
+} */
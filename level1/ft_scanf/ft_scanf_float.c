@@ -0,0 +1,322 @@
+/* Decimal to float/double conversion for %f and %lf (see ft_scanf_buffered.c,
+which cuts the number out of the input and calls this file).
+
+A decimal number is given as w * 10^q, where w holds its first 19
+significant digits (it fits in 64 bits) and `truncated` says whether nonzero
+digits were dropped after them. The result must be the float/double nearest
+to the exact value, exactly like strtof()/strtod(), so that both always give
+the same bits. Three ways, from the fastest:
+
+1. Clinger's fast path: when w and 10^q are both exact in the target type
+   (w <= 2^53 and |q| <= 22 for double), w * 10^q (or w / 10^-q) is a single
+   IEEE operation, which rounds correctly by itself.
+2. Eisel-Lemire: multiply w by a 128-bit approximation of 5^q (the 2^q part is
+   just the exponent) and keep the top bits. The product is always accurate
+   enough to know the correctly rounded result (Mushtak & Lemire, "Fast
+   Number Parsing Without Fallback"), except when w itself is truncated: then
+   w and w + 1 bracket the exact value, and if both round to the same result
+   that result is the answer.
+3. Otherwise (a truncated w in between two results) the caller falls back to
+   strtod()/strtof() on the text.
+
+The 128-bit powers of five (for q from -342 to 308) are computed once, the
+first time they are needed, with a small big-number type: 5^q itself for
+q >= 0, and 2^b / 5^-q rounded up for q < 0. */
+
+#include "ft_scanf.h"
+#include <string.h>
+#include <errno.h>
+
+#define SMALLEST_POWER_OF_FIVE -342
+#define LARGEST_POWER_OF_FIVE 308
+#define BIG_LIMBS 64 // 2048 bits
+#define BIG_ONE_BIT 1800 // 2^1800 / 5^k: enough bits for every k up to 342
+
+// the parameters of a binary format (IEEE binary32 / binary64)
+typedef struct s_binary
+{
+	int			mantissa_bits; // explicit bits: 23 / 52
+	int			minimum_exponent; // -127 / -1023
+	int			infinite_power; // biased exponent of infinity: 0xFF / 0x7FF
+	int			smallest_power_of_ten; // below: always rounds to 0
+	int			largest_power_of_ten; // above: always infinity
+	int			min_round_to_even; // q range where a tie is possible
+	int			max_round_to_even;
+}	t_binary;
+
+static const t_binary	g_float = {23, -127, 0xFF, -65, 38, -17, 10};
+static const t_binary	g_double = {52, -1023, 0x7FF, -342, 308, -4, 23};
+
+// the result before it is packed into a float or double
+typedef struct s_adjusted
+{
+	uint64_t	mantissa;
+	int			power2; // biased exponent
+}	t_adjusted;
+
+// an unsigned integer of up to BIG_LIMBS * 32 bits (limb[0] is the lowest)
+typedef struct s_big
+{
+	uint32_t	limb[BIG_LIMBS];
+	int			len; // limbs in use
+}	t_big;
+
+static uint64_t	g_pow5[2 * (LARGEST_POWER_OF_FIVE - SMALLEST_POWER_OF_FIVE + 1)];
+static int		g_pow5_ready = 0;
+
+static void	big_mul_small(t_big *b, uint32_t m)
+{
+	uint64_t	carry = 0;
+
+	for (int i = 0; i < b->len; i++)
+	{
+		carry += (uint64_t)b->limb[i] * m;
+		b->limb[i] = (uint32_t)carry;
+		carry >>= 32;
+	}
+	if (carry)
+		b->limb[b->len++] = (uint32_t)carry;
+}
+
+static void	big_div_small(t_big *b, uint32_t d)
+{
+	uint64_t	rem = 0;
+
+	for (int i = b->len - 1; i >= 0; i--)
+	{
+		rem = rem << 32 | b->limb[i];
+		b->limb[i] = (uint32_t)(rem / d);
+		rem %= d;
+	}
+	while (b->len > 0 && b->limb[b->len - 1] == 0)
+		b->len--;
+}
+
+static int	big_bitlen(const t_big *b)
+{
+	if (b->len == 0)
+		return 0;
+	return 32 * b->len - __builtin_clz(b->limb[b->len - 1]);
+}
+
+// bit i of b (0 below bit 0 and above the top)
+static int	big_bit(const t_big *b, int i)
+{
+	if (i < 0 || i >= 32 * b->len)
+		return 0;
+	return b->limb[i / 32] >> (i % 32) & 1;
+}
+
+// b >> shift, plus one
+static void	big_shr_plus_one(const t_big *b, int shift, t_big *out)
+{
+	int	i;
+
+	out->len = (big_bitlen(b) - shift + 31) / 32;
+	for (i = 0; i < out->len; i++)
+	{
+		out->limb[i] = 0;
+		for (int j = 0; j < 32; j++)
+			out->limb[i] |= (uint32_t)big_bit(b, shift + 32 * i + j) << j;
+	}
+	for (i = 0; i < out->len && ++out->limb[i] == 0; i++)
+		;
+	if (i == out->len)
+		out->limb[out->len++] = 1;
+}
+
+// the 128 bits of b just below its top bit included (b is shifted left when
+// it is shorter), stored high word first at g_pow5[index]
+static void	store_top128(const t_big *b, int index)
+{
+	int			low = big_bitlen(b) - 128;
+	uint64_t	hi = 0;
+	uint64_t	lo = 0;
+
+	for (int i = 127; i >= 64; i--)
+		hi = hi << 1 | big_bit(b, low + i);
+	for (int i = 63; i >= 0; i--)
+		lo = lo << 1 | big_bit(b, low + i);
+	g_pow5[index] = hi;
+	g_pow5[index + 1] = lo;
+}
+
+static void	init_powers_of_five(void)
+{
+	t_big	p = {{1}, 1}; // 5^q
+	t_big	n = {{0}, BIG_ONE_BIT / 32 + 1}; // 2^BIG_ONE_BIT / 5^k
+	t_big	c;
+	int		z;
+	int		b;
+
+	for (int q = 0; q <= LARGEST_POWER_OF_FIVE; q++)
+	{
+		if (q > 0)
+			big_mul_small(&p, 5);
+		store_top128(&p, 2 * (q - SMALLEST_POWER_OF_FIVE));
+	}
+	// q = -k: c = 2^b / 5^k + 1 (2^b / 5^k is never an integer: rounded up),
+	// with b large enough that c keeps 128 significant bits. Dividing by 5
+	// k times gives floor(2^BIG_ONE_BIT / 5^k) exactly, and shifting it right
+	// gives floor(2^b / 5^k).
+	n.limb[BIG_ONE_BIT / 32] = 1u << (BIG_ONE_BIT % 32);
+	p = (t_big){{1}, 1};
+	for (int k = 1; k <= -SMALLEST_POWER_OF_FIVE; k++)
+	{
+		big_div_small(&n, 5);
+		big_mul_small(&p, 5);
+		z = big_bitlen(&p); // smallest z with 2^z > 5^k
+		b = k <= 27 ? z + 127 : 2 * z + 128;
+		big_shr_plus_one(&n, BIG_ONE_BIT - b, &c);
+		store_top128(&c, 2 * (-k - SMALLEST_POWER_OF_FIVE));
+	}
+	g_pow5_ready = 1;
+}
+
+// w * 5^q with enough precision for `bits` significant bits
+static unsigned __int128	product(int64_t q, uint64_t w, int bits)
+{
+	int					index = 2 * (int)(q - SMALLEST_POWER_OF_FIVE);
+	unsigned __int128	first = (unsigned __int128)w * g_pow5[index];
+	uint64_t			mask = 0xFFFFFFFFFFFFFFFF >> bits;
+
+	// the low bits of the top word are all ones: the lower word of 5^q may
+	// carry into them
+	if (((uint64_t)(first >> 64) & mask) == mask)
+		first += ((unsigned __int128)w * g_pow5[index + 1]) >> 64;
+	return first;
+}
+
+// Eisel-Lemire for w * 10^q, w != 0
+static t_adjusted	compute_float(const t_binary *fmt, int64_t q, uint64_t w)
+{
+	t_adjusted			r;
+	unsigned __int128	prod;
+	uint64_t			high;
+	uint64_t			low;
+	int					lz;
+	int					upper;
+	int					shift;
+
+	if (q < fmt->smallest_power_of_ten)
+		return (t_adjusted){0, 0};
+	if (q > fmt->largest_power_of_ten)
+		return (t_adjusted){0, fmt->infinite_power};
+	lz = __builtin_clzll(w);
+	w <<= lz;
+	prod = product(q, w, fmt->mantissa_bits + 3);
+	high = (uint64_t)(prod >> 64);
+	low = (uint64_t)prod;
+	upper = (int)(high >> 63);
+	shift = upper + 64 - fmt->mantissa_bits - 3;
+	r.mantissa = high >> shift;
+	// 10^q = 5^q * 2^q, and log2(10^q) = q * 217706 / 2^16 (floor, exact here)
+	r.power2 = (int)(((217706 * q) >> 16) + 63 + upper - lz - fmt->minimum_exponent);
+	if (r.power2 <= 0) // subnormal (or zero)
+	{
+		if (-r.power2 + 1 >= 64)
+			return (t_adjusted){0, 0};
+		r.mantissa >>= -r.power2 + 1;
+		r.mantissa += r.mantissa & 1; // round (no exact tie is possible this small)
+		r.mantissa >>= 1;
+		r.power2 = r.mantissa < (1ull << fmt->mantissa_bits) ? 0 : 1;
+		return r;
+	}
+	// exactly halfway between two values: round to even (down)
+	if (low <= 1 && q >= fmt->min_round_to_even && q <= fmt->max_round_to_even
+		&& (r.mantissa & 3) == 1 && (r.mantissa << shift) == high)
+		r.mantissa &= ~1ull;
+	r.mantissa += r.mantissa & 1; // round to nearest
+	r.mantissa >>= 1;
+	if (r.mantissa >= (2ull << fmt->mantissa_bits)) // rounded up to 2^(p+1)
+	{
+		r.mantissa = 1ull << fmt->mantissa_bits;
+		r.power2++;
+	}
+	r.mantissa &= ~(1ull << fmt->mantissa_bits); // the implicit bit
+	if (r.power2 >= fmt->infinite_power)
+		return (t_adjusted){0, fmt->infinite_power};
+	return r;
+}
+
+/* the correctly rounded w * 10^q (w != 0), or power2 == -1 when w is
+truncated and the digits after it could change the result */
+static t_adjusted	eisel_lemire(const t_binary *fmt, const t_decimal *d)
+{
+	t_adjusted	r;
+	t_adjusted	up;
+
+	if (!g_pow5_ready)
+		init_powers_of_five();
+	r = compute_float(fmt, d->q, d->w);
+	if (d->truncated)
+	{
+		up = compute_float(fmt, d->q, d->w + 1);
+		if (up.mantissa != r.mantissa || up.power2 != r.power2)
+			r.power2 = -1;
+	}
+	return r;
+}
+
+// strtod() sets ERANGE when the result overflows or underflows to zero
+static void	set_range_error(const t_binary *fmt, t_adjusted r)
+{
+	if ((r.power2 == fmt->infinite_power && r.mantissa == 0)
+		|| (r.power2 == 0 && r.mantissa == 0))
+		errno = ERANGE;
+}
+
+int	ft_decimal_to_double(const t_decimal *d, double *out)
+{
+	static const double	pow10[23] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7,
+		1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+		1e20, 1e21, 1e22};
+	t_adjusted			r;
+	uint64_t			bits;
+	double				value;
+
+	if (d->w == 0)
+		value = 0;
+	else if (!d->truncated && d->q >= -22 && d->q <= 22 && d->w <= 1ull << 53)
+		value = d->q < 0 ? (double)d->w / pow10[-d->q] : (double)d->w * pow10[d->q];
+	else
+	{
+		r = eisel_lemire(&g_double, d);
+		if (r.power2 < 0)
+			return 0;
+		set_range_error(&g_double, r);
+		bits = r.mantissa | (uint64_t)r.power2 << 52
+			| (uint64_t)d->negative << 63;
+		memcpy(out, &bits, sizeof(double));
+		return 1;
+	}
+	*out = d->negative ? -value : value;
+	return 1;
+}
+
+int	ft_decimal_to_float(const t_decimal *d, float *out)
+{
+	static const float	pow10[11] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f,
+		1e7f, 1e8f, 1e9f, 1e10f};
+	t_adjusted			r;
+	uint32_t			bits;
+	float				value;
+
+	if (d->w == 0)
+		value = 0;
+	else if (!d->truncated && d->q >= -10 && d->q <= 10 && d->w <= 1u << 24)
+		value = d->q < 0 ? (float)d->w / pow10[-d->q] : (float)d->w * pow10[d->q];
+	else
+	{
+		r = eisel_lemire(&g_float, d);
+		if (r.power2 < 0)
+			return 0;
+		set_range_error(&g_float, r);
+		bits = (uint32_t)r.mantissa | (uint32_t)r.power2 << 23
+			| (uint32_t)d->negative << 31;
+		memcpy(out, &bits, sizeof(float));
+		return 1;
+	}
+	*out = d->negative ? -value : value;
+	return 1;
+}
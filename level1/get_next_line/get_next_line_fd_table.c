@@ -0,0 +1,207 @@
+/* get_next_line for many file descriptors at once (e.g. thousands of sockets).
+To be compiled in combination with gnl.h
+
+get_next_line_multiple_fd.c keeps one t_fd_state per fd in a linked list: every
+call walks the list to find its fd, and every state embeds a 100 000 byte line
+buffer (10 000 fds = 1 GB, and a longer line writes past its end). Here:
+- the states live in a table indexed by the fd itself, so finding the state is
+one array access. fds are small integers (open() returns the lowest free one),
+so the table stays dense; it grows by doubling when a larger fd shows up.
+- a state is only what must survive between two calls: the unread bytes of the
+last read(). Its BUFFER_SIZE read buffer is allocated on the first read of the
+fd and freed at EOF, so an idle fd costs sizeof(t_fd_state) + BUFFER_SIZE.
+- the line is built directly in the returned string, which grows by doubling:
+there is no line length limit.
+- gnl_close(fd) drops the state of an fd that is not read until EOF (e.g. a
+connection that is closed early). It does not close the fd itself.
+When no fd has state any more, the table itself is freed: after EOF nothing is
+left allocated, as the subject requires. */
+
+#include "gnl.h"
+
+typedef struct s_fd_state
+{
+	char	*buf; // BUFFER_SIZE bytes, NULL until the first read
+	int		pos; // next unread byte of buf
+	int		size; // bytes in buf
+}	t_fd_state;
+
+static t_fd_state	*g_states = NULL; // g_states[fd]
+static int			g_capacity = 0;
+static int			g_active = 0; // fds that have a read buffer
+
+// a copy of the size first bytes of old in a block of new_size bytes; old is
+// freed, unless malloc fails (then NULL is returned and old is left as it is)
+static void	*gnl_grow(void *old, size_t size, size_t new_size)
+{
+	char	*new = malloc(new_size);
+	size_t	i;
+
+	if (!new)
+		return NULL;
+	i = 0;
+	while (i < size)
+	{
+		new[i] = ((char *)old)[i];
+		i++;
+	}
+	free(old);
+	return new;
+}
+
+// the state of fd, growing the table if needed (NULL if out of memory)
+static t_fd_state	*get_fd_state(int fd)
+{
+	t_fd_state	*states;
+	int			new_capacity;
+	int			i;
+
+	if (fd >= g_capacity)
+	{
+		new_capacity = g_capacity ? g_capacity : 16;
+		while (new_capacity <= fd)
+			new_capacity *= 2;
+		states = gnl_grow(g_states, sizeof(t_fd_state) * g_capacity,
+				sizeof(t_fd_state) * new_capacity);
+		if (!states)
+			return NULL;
+		g_states = states;
+		i = g_capacity;
+		while (i < new_capacity)
+		{
+			g_states[i].buf = NULL;
+			g_states[i].pos = 0;
+			g_states[i].size = 0;
+			i++;
+		}
+		g_capacity = new_capacity;
+	}
+	return &g_states[fd];
+}
+
+void	gnl_close(int fd)
+{
+	if (fd < 0 || fd >= g_capacity)
+		return ;
+	if (g_states[fd].buf)
+	{
+		free(g_states[fd].buf);
+		g_states[fd].buf = NULL;
+		g_active--;
+	}
+	g_states[fd].pos = 0;
+	g_states[fd].size = 0;
+	// the last fd is gone: free the table too
+	if (g_active == 0)
+	{
+		free(g_states);
+		g_states = NULL;
+		g_capacity = 0;
+	}
+}
+
+// the line so far, or NULL if it is empty; fd's state is released
+static char	*finish(int fd, char *line, size_t len)
+{
+	gnl_close(fd);
+	if (line && len == 0)
+	{
+		free(line);
+		return NULL;
+	}
+	if (line)
+		line[len] = '\0';
+	return line;
+}
+
+char	*get_next_line(int fd)
+{
+	t_fd_state	*state;
+	char		*line = NULL;
+	size_t		len = 0;
+	size_t		cap = 0;
+
+	if (fd < 0 || BUFFER_SIZE <= 0)
+		return NULL;
+	state = get_fd_state(fd);
+	if (!state)
+		return NULL;
+	while (1)
+	{
+		if (state->pos >= state->size)
+		{
+			if (!state->buf)
+			{
+				state->buf = malloc(BUFFER_SIZE);
+				if (!state->buf)
+					return finish(fd, line, 0);
+				g_active++;
+			}
+			state->size = read(fd, state->buf, BUFFER_SIZE);
+			state->pos = 0;
+			if (state->size < 0) // read error: the partial line is dropped
+			{
+				state->size = 0;
+				return finish(fd, line, 0);
+			}
+			if (state->size == 0) // EOF
+				return finish(fd, line, len);
+		}
+		// room for the rest of the buffer and the '\0'
+		if (len + (state->size - state->pos) + 1 > cap)
+		{
+			size_t new_cap = cap ? cap * 2 : 64;
+			while (new_cap < len + (state->size - state->pos) + 1)
+				new_cap *= 2;
+			char *new_line = gnl_grow(line, len, new_cap);
+			if (!new_line)
+				return finish(fd, line, 0);
+			line = new_line;
+			cap = new_cap;
+		}
+		while (state->pos < state->size)
+		{
+			char c = state->buf[state->pos++];
+			line[len++] = c;
+			if (c == '\n')
+			{
+				line[len] = '\0';
+				return line;
+			}
+		}
+	}
+}
+
+// TESTING: reads several files in turn, one line from each at a time
+/* int main(int argc, char **argv)
+{
+	int		fds[argc];
+	int		open_fds = 0;
+	char	*line;
+
+	for (int i = 1; i < argc; i++)
+	{
+		fds[i] = open(argv[i], O_RDONLY);
+		if (fds[i] >= 0)
+			open_fds++;
+	}
+	while (open_fds > 0)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (fds[i] < 0)
+				continue ;
+			line = get_next_line(fds[i]);
+			if (!line)
+			{
+				close(fds[i]);
+				fds[i] = -1;
+				open_fds--;
+				continue ;
+			}
+			printf("%s: [%s]\n", argv[i], line);
+			free(line);
+		}
+	}
+	return (0);
+} */
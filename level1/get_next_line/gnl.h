@@ -10,4 +10,28 @@
 #define BUFFER_SIZE 32
 #endif
 
+// one line of a batch (gnl_batch.c)
+typedef struct s_gnl_line
+{
+	char	*str;
+	size_t	len;
+}	t_gnl_line;
+
+// event-driven reader (gnl_epoll.c); line is NULL when fd reaches EOF
+typedef struct s_gnl_poller	t_gnl_poller;
+typedef void	(*t_gnl_line_cb)(int fd, const char *line, size_t len, void *ctx);
+
+char	*get_next_line(int fd);
+void	gnl_close(int fd); // get_next_line_fd_table.c
+int		gnl_next_view(int fd, const char **ptr, size_t *len); // gnl_growable_buffer.c
+int		gnl_mmap_next_view(int fd, const char **ptr, size_t *len); // gnl_mmap.c
+int		gnl_pipelined_next_view(int fd, const char **ptr, size_t *len); // gnl_pipelined.c
+ssize_t	gnl_next_batch(int fd, t_gnl_line *out, size_t k); // gnl_batch.c
+void	gnl_release_batch(int fd); // gnl_batch.c
+t_gnl_poller	*gnl_poller_new(t_gnl_line_cb cb, void *ctx); // gnl_epoll.c
+int		gnl_poller_add(t_gnl_poller *p, int fd);
+int		gnl_poller_remove(t_gnl_poller *p, int fd);
+int		gnl_poller_run_once(t_gnl_poller *p, int timeout_ms);
+void	gnl_poller_free(t_gnl_poller *p);
+
 #endif
@@ -0,0 +1,306 @@
+/* Batched get_next_line: up to k lines per call, stored in an arena that is
+freed in one step. To be compiled in combination with gnl.h
+
+	t_gnl_line	lines[256];
+	ssize_t		n;
+
+	while ((n = gnl_next_batch(fd, lines, 256)) > 0)
+	{
+		for (ssize_t i = 0; i < n; i++)
+			handle(lines[i].str, lines[i].len);
+		gnl_release_batch(fd);
+	}
+
+With get_next_line(), every line is one call, one malloc() and one free() by
+the caller. gnl_next_batch() instead returns all the complete lines that are
+already in the reader's buffer (at most k), and only calls read() when there
+is not a single one: many lines per call and per read(). Every line is copied
+into the fd's ARENA: a few large blocks where the lines are simply placed one
+after the other (a pointer bump, no malloc() per line). Each line is a normal
+'\0'-terminated string ('\n' included, like get_next_line()), and lines[i].len
+saves the strlen(). The strings stay valid until gnl_release_batch(fd), which
+makes the whole arena reusable at once (the next batches then reuse the same
+memory, so a long run does no allocation at all).
+
+The return value is the number of lines, 0 at EOF and -1 on error. When 0 or
+-1 is returned, all the memory of that fd is freed (the arena too).
+Like get_next_line_fd_table.c, the states are in a table indexed by fd, so
+this works for one fd as well as for many fds read in turn. The read buffer
+works like gnl_growable_buffer.c (start, scan and end offsets, read sizes that
+grow from BUFFER_SIZE to GNL_READ_MAX on large inputs). */
+
+#include "gnl.h"
+
+#define GNL_READ_MAX (1024 * 1024)
+#define ARENA_BLOCK (64 * 1024) // smallest arena block
+
+typedef struct s_arena_block
+{
+	struct s_arena_block	*next; // older (smaller) blocks
+	size_t					used;
+	size_t					cap;
+	char					data[];
+}	t_arena_block;
+
+typedef struct s_batch_state
+{
+	char			*buf;
+	size_t			start; // first byte not returned yet
+	size_t			scan; // next byte to look at for '\n'
+	size_t			end;
+	size_t			cap;
+	size_t			read_size;
+	int				eof;
+	t_arena_block	*arena; // the newest (and largest) block first
+}	t_batch_state;
+
+static t_batch_state	**g_states = NULL; // g_states[fd], NULL if fd has no state
+static int				g_capacity = 0;
+static int				g_active = 0;
+
+static void	ft_memmove(char *dst, const char *src, size_t len)
+{
+	size_t	i;
+
+	if (dst < src)
+	{
+		i = 0;
+		while (i < len)
+		{
+			dst[i] = src[i];
+			i++;
+		}
+	}
+	else
+	{
+		while (len > 0)
+		{
+			len--;
+			dst[len] = src[len];
+		}
+	}
+}
+
+// the state of fd, created if needed (NULL if out of memory)
+static t_batch_state	*get_state(int fd)
+{
+	t_batch_state	**states;
+	int				new_capacity;
+	int				i;
+
+	if (fd >= g_capacity)
+	{
+		new_capacity = g_capacity ? g_capacity : 16;
+		while (new_capacity <= fd)
+			new_capacity *= 2;
+		states = malloc(sizeof(t_batch_state *) * new_capacity);
+		if (!states)
+			return NULL;
+		i = 0;
+		while (i < new_capacity)
+		{
+			states[i] = i < g_capacity ? g_states[i] : NULL;
+			i++;
+		}
+		free(g_states);
+		g_states = states;
+		g_capacity = new_capacity;
+	}
+	if (!g_states[fd])
+	{
+		g_states[fd] = malloc(sizeof(t_batch_state));
+		if (!g_states[fd])
+			return NULL;
+		g_states[fd]->buf = NULL;
+		g_states[fd]->start = 0;
+		g_states[fd]->scan = 0;
+		g_states[fd]->end = 0;
+		g_states[fd]->cap = 0;
+		g_states[fd]->read_size = BUFFER_SIZE;
+		g_states[fd]->eof = 0;
+		g_states[fd]->arena = NULL;
+		g_active++;
+	}
+	return g_states[fd];
+}
+
+static void	free_arena(t_arena_block *block)
+{
+	t_arena_block	*next;
+
+	while (block)
+	{
+		next = block->next;
+		free(block);
+		block = next;
+	}
+}
+
+static void	free_state(int fd)
+{
+	t_batch_state	*state = g_states[fd];
+
+	free(state->buf);
+	free_arena(state->arena);
+	free(state);
+	g_states[fd] = NULL;
+	if (--g_active == 0) // nothing left: free the table too
+	{
+		free(g_states);
+		g_states = NULL;
+		g_capacity = 0;
+	}
+}
+
+void	gnl_release_batch(int fd)
+{
+	t_batch_state	*state;
+
+	if (fd < 0 || fd >= g_capacity || !g_states[fd] || !g_states[fd]->arena)
+		return ;
+	state = g_states[fd];
+	// keep the largest block only, and empty it
+	free_arena(state->arena->next);
+	state->arena->next = NULL;
+	state->arena->used = 0;
+}
+
+// size bytes in the arena (NULL if out of memory); older blocks are kept
+static char	*arena_alloc(t_batch_state *state, size_t size)
+{
+	t_arena_block	*block = state->arena;
+	size_t			cap;
+
+	if (!block || block->cap - block->used < size)
+	{
+		cap = block ? block->cap * 2 : ARENA_BLOCK;
+		while (cap < size)
+			cap *= 2;
+		block = malloc(sizeof(t_arena_block) + cap);
+		if (!block)
+			return NULL;
+		block->next = state->arena;
+		block->used = 0;
+		block->cap = cap;
+		state->arena = block;
+	}
+	block->used += size;
+	return block->data + block->used - size;
+}
+
+// make room for read_size more bytes after end (see gnl_growable_buffer.c)
+static int	make_room(t_batch_state *state)
+{
+	size_t	pending = state->end - state->start;
+	size_t	new_cap;
+	char	*new_buf;
+
+	if (state->cap - state->end >= state->read_size)
+		return 0;
+	if (state->start >= pending && state->cap - pending >= state->read_size)
+		new_buf = state->buf;
+	else
+	{
+		new_cap = state->cap ? state->cap * 2 : 2 * state->read_size;
+		while (new_cap - pending < state->read_size)
+			new_cap *= 2;
+		new_buf = malloc(new_cap);
+		if (!new_buf)
+			return -1;
+		state->cap = new_cap;
+	}
+	ft_memmove(new_buf, state->buf + state->start, pending);
+	if (new_buf != state->buf)
+		free(state->buf);
+	state->buf = new_buf;
+	state->scan -= state->start;
+	state->end = pending;
+	state->start = 0;
+	return 0;
+}
+
+// copy the count lines that start at buf[start] into the arena
+static int	copy_lines(t_batch_state *state, t_gnl_line *out, size_t count)
+{
+	size_t	total = 0;
+	size_t	i;
+	char	*dst;
+
+	i = 0;
+	while (i < count)
+		total += out[i++].len + 1;
+	dst = arena_alloc(state, total);
+	if (!dst)
+		return -1;
+	i = 0;
+	while (i < count)
+	{
+		ft_memmove(dst, state->buf + state->start, out[i].len);
+		dst[out[i].len] = '\0';
+		out[i].str = dst;
+		dst += out[i].len + 1;
+		state->start += out[i].len;
+		i++;
+	}
+	if (state->start == state->end) // nothing pending: reuse the buffer from 0
+	{
+		state->start = 0;
+		state->scan = 0;
+		state->end = 0;
+	}
+	return 0;
+}
+
+ssize_t	gnl_next_batch(int fd, t_gnl_line *out, size_t k)
+{
+	t_batch_state	*state;
+	size_t			count = 0;
+	size_t			line_start;
+	ssize_t			bytes;
+
+	if (fd < 0 || BUFFER_SIZE <= 0 || k == 0)
+		return -1;
+	state = get_state(fd);
+	if (!state)
+		return -1;
+	line_start = state->start;
+	while (1)
+	{
+		// every complete line that is already there, up to k
+		while (count < k && state->scan < state->end)
+		{
+			if (state->buf[state->scan++] == '\n')
+			{
+				out[count++].len = state->scan - line_start;
+				line_start = state->scan;
+			}
+		}
+		if (count > 0)
+			break ;
+		if (state->eof)
+		{
+			// the last line has no '\n'
+			if (state->end > state->start)
+				out[count++].len = state->end - state->start;
+			break ;
+		}
+		// not a single line: one more read()
+		if (make_room(state) != 0)
+			break ;
+		line_start = state->start;
+		bytes = read(fd, state->buf + state->end, state->read_size);
+		if (bytes < 0)
+			break ;
+		if (bytes == 0)
+			state->eof = 1;
+		state->end += bytes;
+		if ((size_t)bytes == state->read_size && state->read_size < GNL_READ_MAX)
+			state->read_size *= 2;
+	}
+	if (count > 0 && copy_lines(state, out, count) == 0)
+		return count;
+	// EOF or error: fd is done
+	bytes = count == 0 && state->eof ? 0 : -1;
+	free_state(fd);
+	return bytes;
+}
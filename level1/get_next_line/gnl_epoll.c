@@ -0,0 +1,348 @@
+/* Event-driven line reader for many fds on one thread (Linux, epoll). To be
+compiled in combination with gnl.h
+
+	void on_line(int fd, const char *line, size_t len, void *ctx)
+	{
+		if (!line)
+			close(fd); // EOF (or error): fd has left the poller
+		else
+			handle(line, len);
+	}
+
+	t_gnl_poller *p = gnl_poller_new(on_line, ctx);
+	gnl_poller_add(p, client_fd); // as many as needed
+	while (gnl_poller_run_once(p, -1) >= 0)
+		;
+	gnl_poller_free(p);
+
+Every get_next_line() blocks in read() until a whole line has arrived, so
+serving n clients that way takes n threads. Here the fds are made
+non-blocking and registered in an epoll set, and gnl_poller_run_once() only
+reads the fds that the kernel says are readable, with one read() each: a slow
+client can never hold the others up. The bytes that have arrived are cut into
+lines and handed to the callback ('\n' included, NOT '\0'-terminated, valid
+until the callback returns or removes that fd). When an fd reaches EOF, its
+last line (if it has no '\n') is delivered, then the callback is called once
+with line == NULL; the fd is removed from the poller (its flags restored) but
+not closed. A read error is reported the same way, and errno tells them apart
+in the NULL call: 0 at EOF, the read() error, or ENOMEM when the unfinished
+line could not be kept (that line is dropped, never delivered cut short).
+
+Most lines are delivered straight from the shared read buffer without any
+copy. Only the beginning of a line that is not complete yet is kept, in the
+fd's own growable buffer, until the rest arrives. The per-fd states are in a
+table indexed by fd (see get_next_line_fd_table.c): an idle fd costs
+sizeof(t_conn) bytes, so 10 000 clients fit easily.
+
+The callback may call gnl_poller_add() and gnl_poller_remove() (for any fd,
+its own included). */
+
+#include "gnl.h"
+#include <errno.h>
+#include <sys/epoll.h>
+
+#define POLL_EVENTS 256 // events handled per epoll_wait()
+#define POLL_READ_SIZE (64 * 1024) // shared read buffer
+
+typedef struct s_conn
+{
+	int		active; // registered in the poller
+	int		flags; // the fd's flags before gnl_poller_add(), restored on removal
+	char	*partial; // start of a line whose '\n' has not arrived yet
+	size_t	len;
+	size_t	cap;
+}	t_conn;
+
+struct s_gnl_poller
+{
+	int				epfd;
+	t_gnl_line_cb	cb;
+	void			*ctx;
+	t_conn			*conns; // conns[fd]
+	int				capacity;
+	char			*buf; // POLL_READ_SIZE bytes, shared by all fds
+};
+
+t_gnl_poller	*gnl_poller_new(t_gnl_line_cb cb, void *ctx)
+{
+	t_gnl_poller	*p = malloc(sizeof(t_gnl_poller));
+
+	if (!p)
+		return NULL;
+	p->cb = cb;
+	p->ctx = ctx;
+	p->conns = NULL;
+	p->capacity = 0;
+	p->buf = malloc(POLL_READ_SIZE);
+	p->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (!p->buf || p->epfd < 0)
+	{
+		if (p->epfd >= 0)
+			close(p->epfd);
+		free(p->buf);
+		free(p);
+		return NULL;
+	}
+	return p;
+}
+
+int	gnl_poller_add(t_gnl_poller *p, int fd)
+{
+	struct epoll_event	ev;
+	int					flags;
+
+	if (fd < 0 || (fd < p->capacity && p->conns[fd].active))
+		return -1;
+	if (fd >= p->capacity)
+	{
+		int new_capacity = p->capacity ? p->capacity : 64;
+		while (new_capacity <= fd)
+			new_capacity *= 2;
+		t_conn *conns = malloc(sizeof(t_conn) * new_capacity);
+		if (!conns)
+			return -1;
+		for (int i = 0; i < new_capacity; i++)
+		{
+			if (i < p->capacity)
+				conns[i] = p->conns[i];
+			else
+			{
+				conns[i].active = 0;
+				conns[i].flags = 0;
+				conns[i].partial = NULL;
+				conns[i].len = 0;
+				conns[i].cap = 0;
+			}
+		}
+		free(p->conns);
+		p->conns = conns;
+		p->capacity = new_capacity;
+	}
+	// a readable fd may still have less than a whole line: read() must not wait
+	flags = fcntl(fd, F_GETFL);
+	if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+		return -1;
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(p->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)
+	{
+		fcntl(fd, F_SETFL, flags); // not added: leave fd as it was
+		return -1;
+	}
+	p->conns[fd].active = 1;
+	p->conns[fd].flags = flags;
+	return 0;
+}
+
+// forget fd (pending bytes included); fd itself stays open, as it was before
+int	gnl_poller_remove(t_gnl_poller *p, int fd)
+{
+	t_conn	*c;
+
+	if (fd < 0 || fd >= p->capacity || !p->conns[fd].active)
+		return -1;
+	c = &p->conns[fd];
+	// fails if fd was closed already: then its number may belong to another
+	// file now, whose flags must not be touched
+	if (epoll_ctl(p->epfd, EPOLL_CTL_DEL, fd, NULL) == 0)
+		fcntl(fd, F_SETFL, c->flags);
+	free(c->partial);
+	c->partial = NULL;
+	c->len = 0;
+	c->cap = 0;
+	c->active = 0;
+	return 0;
+}
+
+// append to the fd's unfinished line
+static int	keep_partial(t_conn *c, const char *s, size_t len)
+{
+	if (c->len + len > c->cap)
+	{
+		size_t new_cap = c->cap ? c->cap * 2 : 128;
+		while (new_cap < c->len + len)
+			new_cap *= 2;
+		char *partial = malloc(new_cap);
+		if (!partial)
+			return -1;
+		for (size_t i = 0; i < c->len; i++)
+			partial[i] = c->partial[i];
+		free(c->partial);
+		c->partial = partial;
+		c->cap = new_cap;
+	}
+	for (size_t i = 0; i < len; i++)
+		c->partial[c->len + i] = s[i];
+	c->len += len;
+	return 0;
+}
+
+// the callback can remove fd (or add fds, which may move the table)
+static int	still_active(t_gnl_poller *p, int fd)
+{
+	return fd < p->capacity && p->conns[fd].active;
+}
+
+// end of fd (err: 0 or the read() error): its last line, then the NULL line
+static void	finish(t_gnl_poller *p, int fd, int err)
+{
+	t_conn	*c = &p->conns[fd];
+
+	if (c->len > 0)
+	{
+		p->cb(fd, c->partial, c->len, p->ctx);
+		if (!still_active(p, fd))
+			return ;
+	}
+	gnl_poller_remove(p, fd);
+	errno = err;
+	p->cb(fd, NULL, 0, p->ctx);
+}
+
+// the unfinished line could not be kept: drop it, report fd as an error
+static void	fail(t_gnl_poller *p, int fd)
+{
+	gnl_poller_remove(p, fd);
+	errno = ENOMEM;
+	p->cb(fd, NULL, 0, p->ctx);
+}
+
+// one read() from a readable fd, and the lines it completes
+static void	handle_readable(t_gnl_poller *p, int fd)
+{
+	ssize_t	bytes = read(fd, p->buf, POLL_READ_SIZE);
+	size_t	start = 0;
+	size_t	i;
+
+	if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return ; // nothing after all: wait for the next event
+	if (bytes <= 0)
+	{
+		finish(p, fd, bytes < 0 ? errno : 0);
+		return ;
+	}
+	i = 0;
+	while (i < (size_t)bytes)
+	{
+		if (p->buf[i++] != '\n')
+			continue ;
+		t_conn *c = &p->conns[fd];
+		if (c->len == 0) // a whole line in the read buffer: no copy
+			p->cb(fd, p->buf + start, i - start, p->ctx);
+		else
+		{
+			// the end of a line that started in an earlier read()
+			if (keep_partial(c, p->buf + start, i - start) != 0)
+			{
+				fail(p, fd);
+				return ;
+			}
+			size_t len = c->len;
+			c->len = 0; // the buffer is free for the next unfinished line
+			p->cb(fd, c->partial, len, p->ctx);
+		}
+		start = i;
+		if (!still_active(p, fd))
+			return ;
+	}
+	if (start < (size_t)bytes
+		&& keep_partial(&p->conns[fd], p->buf + start, bytes - start) != 0)
+		fail(p, fd);
+}
+
+int	gnl_poller_run_once(t_gnl_poller *p, int timeout_ms)
+{
+	struct epoll_event	events[POLL_EVENTS];
+	int					n;
+
+	n = epoll_wait(p->epfd, events, POLL_EVENTS, timeout_ms);
+	if (n < 0)
+		return errno == EINTR ? 0 : -1;
+	for (int i = 0; i < n; i++)
+	{
+		int fd = events[i].data.fd;
+		// an earlier callback of this round may have removed it
+		if (still_active(p, fd))
+			handle_readable(p, fd);
+	}
+	return n;
+}
+
+void	gnl_poller_free(t_gnl_poller *p)
+{
+	if (!p)
+		return ;
+	for (int fd = 0; fd < p->capacity; fd++)
+		free(p->conns[fd].partial);
+	free(p->conns);
+	free(p->buf);
+	close(p->epfd);
+	free(p);
+}
+
+// TESTING: 5000 socketpairs (10 000 fds), each written in small pieces (lines
+// cut anywhere). Compile with: gcc gnl_epoll.c (after uncommenting), and run it
+// after ulimit -n 10100 (the default limit is often 1024 fds)
+/* #include <sys/socket.h>
+#include <string.h>
+
+#define CLIENTS 5000
+
+int g_lines = 0;
+int g_closed = 0;
+
+void on_line(int fd, const char *line, size_t len, void *ctx)
+{
+	(void)ctx;
+	if (!line)
+	{
+		close(fd);
+		g_closed++;
+		return ;
+	}
+	if (len != 12 || memcmp(line, "hello world\n", 12) != 0)
+		printf("KO: fd %d got [%.*s]\n", fd, (int)len, line);
+	g_lines++;
+}
+
+int main(void)
+{
+	const char *text = "hello world\nhello world\nhello world\n";
+	size_t text_len = strlen(text);
+	int writers[CLIENTS];
+	size_t sent[CLIENTS];
+	t_gnl_poller *p = gnl_poller_new(on_line, NULL);
+
+	for (int i = 0; i < CLIENTS; i++)
+	{
+		int sv[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0 || gnl_poller_add(p, sv[0]) != 0)
+			return (1);
+		writers[i] = sv[1];
+		sent[i] = 0;
+	}
+	// every round, every client sends a few more bytes (or hangs up)
+	while (g_closed < CLIENTS)
+	{
+		for (int i = 0; i < CLIENTS; i++)
+		{
+			if (writers[i] < 0)
+				continue ;
+			if (sent[i] == text_len)
+			{
+				close(writers[i]);
+				writers[i] = -1;
+				continue ;
+			}
+			size_t n = 1 + (i + sent[i]) % 7;
+			if (n > text_len - sent[i])
+				n = text_len - sent[i];
+			sent[i] += write(writers[i], text + sent[i], n);
+		}
+		if (gnl_poller_run_once(p, 100) < 0)
+			return (1);
+	}
+	gnl_poller_free(p);
+	printf("%d lines from %d clients\n", g_lines, g_closed);
+	return (0);
+} */
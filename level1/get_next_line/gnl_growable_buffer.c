@@ -0,0 +1,220 @@
+/* get_next_line in linear time, with one growable buffer. To be compiled in
+combination with gnl.h
+
+In gnl_standard_malloc.c every read() of BUFFER_SIZE bytes goes through
+ft_strjoin(), which allocates a new stash and copies the whole old one into
+it, and ft_strchr() searches the whole stash for '\n' again each time. A line
+of L bytes therefore costs about L / BUFFER_SIZE copies of up to L bytes:
+O(L^2). Here the stash is a single buffer that is kept between calls:
+
+	buf: [ consumed | pending bytes ........ | free space ]
+	     0          start       scan         end          cap
+
+- the bytes of the next line(s) are buf[start..end). After a line is returned
+start simply moves past it: nothing is copied.
+- scan remembers where the last search for '\n' stopped, so every byte is
+looked at once, however many read() calls a line needs.
+- when the free space runs out, the pending bytes are moved to the front if
+they are fewer than the consumed ones (the move costs less than the bytes
+already returned), otherwise the buffer doubles in size. Each byte is thus
+copied a constant number of times on average.
+- the read size starts at BUFFER_SIZE and doubles every time a read() fills it
+completely (a big file or a fast pipe), up to GNL_READ_MAX: large inputs need
+few system calls, while a terminal still gets small reads.
+Every line costs one malloc() (the returned string), plus the rare growths.
+Like gnl_standard_malloc.c this handles one fd at a time, and at EOF the buffer
+is freed.
+
+gnl_next_view() is the same reader without the malloc() and the copy: it
+points into the buffer instead of returning a new string.
+	const char	*line;
+	size_t		len;
+	while (gnl_next_view(fd, &line, &len) == 1)
+		fwrite(line, 1, len, stdout);
+The view (the '\n' included, NOT '\0'-terminated) is valid until the next call,
+which may move or overwrite the buffer. It returns 1 for a line, 0 at EOF (the
+buffer is then freed) and -1 on error. get_next_line() is a thin wrapper that
+copies the view into a new string. */
+
+#include "gnl.h"
+
+#define GNL_READ_MAX (1024 * 1024)
+
+typedef struct s_stash
+{
+	char	*buf;
+	size_t	start; // first byte not returned yet
+	size_t	scan; // buf[start..scan) holds no '\n'
+	size_t	end; // end of the data read so far
+	size_t	cap;
+	size_t	read_size; // bytes asked to the next read()
+}	t_stash;
+
+static void	ft_memmove(char *dst, const char *src, size_t len)
+{
+	size_t	i;
+
+	if (dst < src)
+	{
+		i = 0;
+		while (i < len)
+		{
+			dst[i] = src[i];
+			i++;
+		}
+	}
+	else
+	{
+		while (len > 0)
+		{
+			len--;
+			dst[len] = src[len];
+		}
+	}
+}
+
+static void	free_stash(t_stash *stash)
+{
+	free(stash->buf);
+	stash->buf = NULL;
+	stash->start = 0;
+	stash->scan = 0;
+	stash->end = 0;
+	stash->cap = 0;
+	stash->read_size = 0;
+}
+
+// make room for read_size more bytes after end; -1 if malloc fails
+static int	make_room(t_stash *stash)
+{
+	size_t	pending = stash->end - stash->start;
+	size_t	new_cap;
+	char	*new_buf;
+
+	if (stash->cap - stash->end >= stash->read_size)
+		return 0;
+	// cheap: fewer bytes to move than the ones already returned
+	if (stash->start >= pending && stash->cap - pending >= stash->read_size)
+	{
+		ft_memmove(stash->buf, stash->buf + stash->start, pending);
+		stash->scan -= stash->start;
+		stash->end = pending;
+		stash->start = 0;
+		return 0;
+	}
+	new_cap = stash->cap ? stash->cap * 2 : 2 * stash->read_size;
+	while (new_cap - pending < stash->read_size)
+		new_cap *= 2;
+	new_buf = malloc(new_cap);
+	if (!new_buf)
+		return -1;
+	ft_memmove(new_buf, stash->buf + stash->start, pending);
+	free(stash->buf);
+	stash->buf = new_buf;
+	stash->cap = new_cap;
+	stash->scan -= stash->start;
+	stash->end = pending;
+	stash->start = 0;
+	return 0;
+}
+
+// point the view at buf[start..start + len) and move start past it; the bytes
+// stay where they are until the next call
+static int	take_line(t_stash *stash, size_t len, const char **ptr, size_t *len_out)
+{
+	*ptr = stash->buf + stash->start;
+	*len_out = len;
+	stash->start += len;
+	stash->scan = stash->start;
+	if (stash->start == stash->end) // nothing pending: reuse the buffer from 0
+	{
+		stash->start = 0;
+		stash->scan = 0;
+		stash->end = 0;
+	}
+	return 1;
+}
+
+int	gnl_next_view(int fd, const char **ptr, size_t *len)
+{
+	static t_stash	stash = {NULL, 0, 0, 0, 0, 0};
+	ssize_t			bytes;
+
+	if (fd < 0 || BUFFER_SIZE <= 0)
+		return -1;
+	if (stash.read_size == 0)
+		stash.read_size = BUFFER_SIZE;
+	while (1)
+	{
+		// only the bytes that were not searched yet
+		while (stash.scan < stash.end)
+		{
+			if (stash.buf[stash.scan++] == '\n')
+				return take_line(&stash, stash.scan - stash.start, ptr, len);
+		}
+		if (make_room(&stash) != 0)
+		{
+			free_stash(&stash);
+			return -1;
+		}
+		bytes = read(fd, stash.buf + stash.end, stash.read_size);
+		if (bytes < 0)
+		{
+			free_stash(&stash);
+			return -1;
+		}
+		if (bytes == 0)
+		{
+			// the last line has no '\n'; the buffer is freed on the next call
+			if (stash.end > stash.start)
+				return take_line(&stash, stash.end - stash.start, ptr, len);
+			free_stash(&stash);
+			return 0;
+		}
+		stash.end += bytes;
+		if ((size_t)bytes == stash.read_size && stash.read_size < GNL_READ_MAX)
+			stash.read_size *= 2;
+	}
+}
+
+char	*get_next_line(int fd)
+{
+	const char	*view;
+	size_t		len;
+	char		*line;
+
+	if (gnl_next_view(fd, &view, &len) != 1)
+		return NULL;
+	line = malloc(len + 1);
+	if (!line)
+		return NULL;
+	ft_memmove(line, view, len);
+	line[len] = '\0';
+	return line;
+}
+
+// TESTING: prints the number of lines and bytes of a file (or stdin)
+/* int main(int argc, char **argv)
+{
+	int		fd = 0;
+	char	*line;
+	size_t	lines = 0;
+	size_t	bytes = 0;
+
+	if (argc == 2)
+		fd = open(argv[1], O_RDONLY);
+	if (fd < 0)
+	{
+		perror("Error opening file");
+		return (1);
+	}
+	while ((line = get_next_line(fd)) != NULL)
+	{
+		lines++;
+		for (size_t i = 0; line[i]; i++)
+			bytes++;
+		free(line);
+	}
+	printf("%zu lines, %zu bytes\n", lines, bytes);
+	return (0);
+} */
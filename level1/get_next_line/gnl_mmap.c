@@ -0,0 +1,170 @@
+/* Line iterator over a memory-mapped file. To be compiled in combination with
+gnl.h and gnl_growable_buffer.c (the fallback):
+	gcc gnl_mmap.c gnl_growable_buffer.c
+
+	const char	*line;
+	size_t		len;
+	while (gnl_mmap_next_view(fd, &line, &len) == 1)
+		fwrite(line, 1, len, stdout);
+
+get_next_line_single_fd.c copies every byte twice (read() into buffer, then
+into temp_line) and looks for '\n' one byte at a time. When fd is a regular
+file, nothing has to be copied at all: the file is mmap()ed once (with
+MADV_SEQUENTIAL, so the kernel reads ahead aggressively and drops the pages
+behind us), and every line is returned as a slice of the mapping, '\n'
+included and NOT '\0'-terminated. The slices stay valid until EOF is reported.
+'\n' is searched 32 bytes at a time with AVX2 (16 with SSE2): compare a whole
+vector with '\n', turn the result into a bit mask, and the lowest set bit is
+the first newline. A plain loop is used without either instruction set.
+
+Reading starts at the current file offset, and at EOF the offset is moved to
+the end of the file, as if everything had been read with read(). Anything
+that cannot be mapped (pipes, sockets, ttys, empty files) goes through
+gnl_next_view() instead, which has the same return values: 1 for a line, 0 at
+EOF, -1 on error. Like the other versions, one fd is read at a time. */
+
+#include "gnl.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+# include <immintrin.h>
+#endif
+
+enum e_source
+{
+	SOURCE_NONE, // no fd yet, or the last one is finished
+	SOURCE_MAP,
+	SOURCE_READ, // not mappable: gnl_next_view()
+};
+
+typedef struct s_mapped
+{
+	int				fd;
+	enum e_source	source;
+	char			*map;
+	size_t			size;
+	size_t			pos; // start of the next line
+}	t_mapped;
+
+// first '\n' in s[0..n), or n if there is none
+static size_t	find_newline(const char *s, size_t n)
+{
+	size_t	i = 0;
+
+#ifdef __AVX2__
+	__m256i	nl32 = _mm256_set1_epi8('\n');
+	while (i + 32 <= n)
+	{
+		unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+					_mm256_loadu_si256((const __m256i *)(s + i)), nl32));
+		if (mask)
+			return i + __builtin_ctz(mask);
+		i += 32;
+	}
+#endif
+#ifdef __SSE2__
+	__m128i	nl16 = _mm_set1_epi8('\n');
+	while (i + 16 <= n)
+	{
+		unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(
+					_mm_loadu_si128((const __m128i *)(s + i)), nl16));
+		if (mask)
+			return i + __builtin_ctz(mask);
+		i += 16;
+	}
+#endif
+	while (i < n && s[i] != '\n')
+		i++;
+	return i;
+}
+
+// map fd if it is a regular file with something left to read
+static enum e_source	open_source(t_mapped *m, int fd)
+{
+	struct stat	st;
+	off_t		offset;
+
+	m->fd = fd;
+	m->map = NULL;
+	offset = lseek(fd, 0, SEEK_CUR);
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || offset < 0
+		|| offset >= st.st_size)
+		return SOURCE_READ;
+	m->map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m->map == MAP_FAILED)
+	{
+		m->map = NULL;
+		return SOURCE_READ;
+	}
+	madvise(m->map, st.st_size, MADV_SEQUENTIAL);
+	m->size = st.st_size;
+	m->pos = offset;
+	return SOURCE_MAP;
+}
+
+// unmap, and leave the file offset where reading stopped
+static void	close_source(t_mapped *m)
+{
+	if (m->source == SOURCE_MAP)
+	{
+		lseek(m->fd, m->pos, SEEK_SET);
+		munmap(m->map, m->size);
+	}
+	m->map = NULL;
+	m->source = SOURCE_NONE;
+}
+
+int	gnl_mmap_next_view(int fd, const char **ptr, size_t *len)
+{
+	static t_mapped	m = {-1, SOURCE_NONE, NULL, 0, 0};
+	size_t			nl;
+
+	if (fd < 0)
+		return -1;
+	if (m.source != SOURCE_NONE && m.fd != fd) // switching to another fd
+		close_source(&m);
+	if (m.source == SOURCE_NONE)
+		m.source = open_source(&m, fd);
+	if (m.source == SOURCE_READ)
+	{
+		int ret = gnl_next_view(fd, ptr, len);
+		if (ret != 1)
+			m.source = SOURCE_NONE;
+		return ret;
+	}
+	if (m.pos == m.size)
+	{
+		close_source(&m);
+		return 0;
+	}
+	nl = find_newline(m.map + m.pos, m.size - m.pos);
+	*ptr = m.map + m.pos;
+	*len = nl < m.size - m.pos ? nl + 1 : nl; // the last line may have no '\n'
+	m.pos += *len;
+	return 1;
+}
+
+// TESTING: prints the number of lines and bytes of a file (or stdin)
+/* int main(int argc, char **argv)
+{
+	int			fd = 0;
+	const char	*line;
+	size_t		len;
+	size_t		lines = 0;
+	size_t		bytes = 0;
+
+	if (argc == 2)
+		fd = open(argv[1], O_RDONLY);
+	if (fd < 0)
+	{
+		perror("Error opening file");
+		return (1);
+	}
+	while (gnl_mmap_next_view(fd, &line, &len) == 1)
+	{
+		lines++;
+		bytes += len;
+	}
+	printf("%zu lines, %zu bytes\n", lines, bytes);
+	return (0);
+} */
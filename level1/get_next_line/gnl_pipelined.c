@@ -0,0 +1,340 @@
+/* Pipelined get_next_line: a reader thread does the read() calls while the
+caller's thread cuts lines. To be compiled in combination with gnl.h:
+	gcc -pthread gnl_pipelined.c
+
+	const char	*line;
+	size_t		len;
+	while (gnl_pipelined_next_view(fd, &line, &len) == 1)
+		handle(line, len);
+
+In the other versions, the thread that wants lines also waits for read():
+while the disk (or the pipe) delivers data nothing is parsed, and while lines
+are being parsed nothing is read, so the total time is I/O + parsing. Here a
+background thread fills a ring of RING_SLOTS buffers of RING_BUF_SIZE bytes,
+and the caller takes lines out of the buffers that are already full. With
+both running at the same time, the total is close to the larger of the two.
+For regular files the kernel is also told that the file is read sequentially
+(posix_fadvise), and the range after the one being read is requested in
+advance, so that the disk never waits for the next read() either.
+
+The two threads share nothing but two counters: `filled` is only written by
+the reader (buffers ready) and `released` only by the caller (buffers given
+back). Slot i % RING_SLOTS belongs to the reader while filled <= i and
+filled - released < RING_SLOTS, and to the caller once filled > i until it is
+released. The reader stores the data, THEN increments filled with a release
+store, and the caller reads filled with an acquire load before it looks at the
+data: C11 atomics guarantee the data is visible, without any lock. A side that
+has to wait spins a little, then yields, then sleeps a few microseconds at a
+time (a slow pipe must not cost a whole CPU).
+
+Lines are returned as views ('\n' included, NOT '\0'-terminated, valid until
+the next call) into the ring buffer when the line is inside one buffer, or
+into a carry buffer when it spans two or more. Return values like
+gnl_next_view(): 1 for a line, 0 at EOF and -1 on error; at EOF or error the
+thread is joined and everything is freed. get_next_line() is a wrapper that
+copies the view. One fd at a time: calling with another fd drops what is left
+of the first one (after its current read() returns). */
+
+#define _GNU_SOURCE // posix_fadvise() with older glibc
+#include "gnl.h"
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#define RING_SLOTS 4
+#ifndef RING_BUF_SIZE
+# define RING_BUF_SIZE (1024 * 1024)
+#endif
+#define SPIN_LIMIT 200 // busy checks before yielding
+#define YIELD_LIMIT 200 // yields before sleeping
+
+typedef struct s_slot
+{
+	char	*data; // RING_BUF_SIZE bytes
+	size_t	len;
+	int		last; // the reader stopped after this buffer
+	int		error; // ... because read() failed (errno in err)
+	int		err;
+}	t_slot;
+
+typedef struct s_pipeline
+{
+	int				fd;
+	int				is_file; // regular file: posix_fadvise() hints
+	pthread_t		thread;
+	t_slot			slots[RING_SLOTS];
+	atomic_size_t	filled; // written by the reader only
+	atomic_size_t	released; // written by the caller only
+	atomic_int		stop; // the caller asks the reader to quit
+	// caller side
+	size_t			pos; // next byte of the current slot
+	int				have_slot;
+	char			*carry; // a line that spans buffers
+	size_t			carry_len;
+	size_t			carry_cap;
+}	t_pipeline;
+
+static t_pipeline	*g_pipe = NULL;
+
+// wait politely: spin, then yield the CPU, then sleep 50 us at a time
+static void	backoff(int *round)
+{
+	struct timespec	ts = {0, 50000};
+
+	if (*round < SPIN_LIMIT)
+		;
+	else if (*round < SPIN_LIMIT + YIELD_LIMIT)
+		sched_yield();
+	else
+		nanosleep(&ts, NULL);
+	(*round)++;
+}
+
+// fill one buffer (fewer bytes only at EOF); -1 on error
+static ssize_t	fill(t_pipeline *p, char *buf)
+{
+	size_t	len = 0;
+	ssize_t	bytes;
+
+	while (len < RING_BUF_SIZE)
+	{
+		bytes = read(p->fd, buf + len, RING_BUF_SIZE - len);
+		if (bytes < 0 && errno == EINTR)
+			continue ;
+		if (bytes < 0)
+			return -1;
+		if (bytes == 0)
+			break ;
+		len += bytes;
+		// a pipe or a terminal: hand over what is there instead of waiting
+		// for a full megabyte
+		if (!p->is_file)
+			break ;
+	}
+	return len;
+}
+
+static void	*reader_main(void *arg)
+{
+	t_pipeline	*p = arg;
+	size_t		i = 0;
+	off_t		offset = p->is_file ? lseek(p->fd, 0, SEEK_CUR) : 0;
+	int			round;
+
+	while (1)
+	{
+		// wait for a free slot
+		round = 0;
+		while (i - atomic_load_explicit(&p->released, memory_order_acquire) >= RING_SLOTS)
+		{
+			if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+				return NULL;
+			backoff(&round);
+		}
+		if (atomic_load_explicit(&p->stop, memory_order_relaxed))
+			return NULL;
+		t_slot *slot = &p->slots[i % RING_SLOTS];
+		// start fetching what comes after this buffer while it is being read
+		if (p->is_file && offset >= 0)
+			posix_fadvise(p->fd, offset + RING_BUF_SIZE, RING_BUF_SIZE * RING_SLOTS,
+				POSIX_FADV_WILLNEED);
+		ssize_t len = fill(p, slot->data);
+		slot->error = len < 0;
+		slot->err = errno;
+		slot->len = len < 0 ? 0 : len;
+		slot->last = len <= 0;
+		offset += slot->len;
+		// publish: the data above is visible before the new count
+		atomic_store_explicit(&p->filled, ++i, memory_order_release);
+		if (slot->last)
+			return NULL;
+	}
+}
+
+static void	free_pipeline(t_pipeline *p)
+{
+	atomic_store_explicit(&p->stop, 1, memory_order_relaxed);
+	pthread_join(p->thread, NULL);
+	for (int i = 0; i < RING_SLOTS; i++)
+		free(p->slots[i].data);
+	free(p->carry);
+	free(p);
+}
+
+static t_pipeline	*start_pipeline(int fd)
+{
+	t_pipeline	*p = calloc(1, sizeof(t_pipeline));
+	struct stat	st;
+	int			i;
+
+	if (!p)
+		return NULL;
+	p->fd = fd;
+	p->is_file = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+	if (p->is_file)
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL); // larger readahead
+	atomic_init(&p->filled, 0);
+	atomic_init(&p->released, 0);
+	atomic_init(&p->stop, 0);
+	i = 0;
+	while (i < RING_SLOTS && (p->slots[i].data = malloc(RING_BUF_SIZE)) != NULL)
+		i++;
+	if (i < RING_SLOTS || pthread_create(&p->thread, NULL, reader_main, p) != 0)
+	{
+		while (i-- > 0)
+			free(p->slots[i].data);
+		free(p);
+		return NULL;
+	}
+	return p;
+}
+
+static int	append_carry(t_pipeline *p, const char *s, size_t len)
+{
+	if (p->carry_len + len > p->carry_cap)
+	{
+		size_t new_cap = p->carry_cap ? p->carry_cap * 2 : 4096;
+		while (new_cap < p->carry_len + len)
+			new_cap *= 2;
+		char *carry = malloc(new_cap);
+		if (!carry)
+			return -1;
+		if (p->carry_len > 0)
+			memcpy(carry, p->carry, p->carry_len);
+		free(p->carry);
+		p->carry = carry;
+		p->carry_cap = new_cap;
+	}
+	memcpy(p->carry + p->carry_len, s, len);
+	p->carry_len += len;
+	return 0;
+}
+
+// the whole carry as the line; it is emptied (the bytes stay until next call)
+static int	take_carry(t_pipeline *p, const char **ptr, size_t *len)
+{
+	*ptr = p->carry;
+	*len = p->carry_len;
+	p->carry_len = 0;
+	return 1;
+}
+
+static int	stop_pipeline(int ret, int err)
+{
+	free_pipeline(g_pipe);
+	g_pipe = NULL;
+	errno = err;
+	return ret;
+}
+
+int	gnl_pipelined_next_view(int fd, const char **ptr, size_t *len)
+{
+	t_pipeline	*p;
+	int			round;
+
+	if (fd < 0)
+		return -1;
+	if (g_pipe && g_pipe->fd != fd)
+		stop_pipeline(0, 0);
+	if (!g_pipe && (g_pipe = start_pipeline(fd)) == NULL)
+		return -1;
+	p = g_pipe;
+	while (1)
+	{
+		if (!p->have_slot)
+		{
+			// wait for the reader to publish the next buffer
+			size_t next = atomic_load_explicit(&p->released, memory_order_relaxed);
+			round = 0;
+			while (atomic_load_explicit(&p->filled, memory_order_acquire) <= next)
+				backoff(&round);
+			p->have_slot = 1;
+			p->pos = 0;
+		}
+		t_slot *slot = &p->slots[atomic_load_explicit(&p->released,
+				memory_order_relaxed) % RING_SLOTS];
+		if (p->pos < slot->len)
+		{
+			char *start = slot->data + p->pos;
+			char *nl = memchr(start, '\n', slot->len - p->pos);
+			if (nl)
+			{
+				p->pos = nl + 1 - slot->data;
+				if (p->carry_len == 0) // inside this buffer: no copy
+				{
+					*ptr = start;
+					*len = nl + 1 - start;
+					return 1;
+				}
+				if (append_carry(p, start, nl + 1 - start) != 0)
+					return stop_pipeline(-1, ENOMEM);
+				return take_carry(p, ptr, len);
+			}
+			// the line goes on in the next buffer
+			if (append_carry(p, start, slot->len - p->pos) != 0)
+				return stop_pipeline(-1, ENOMEM);
+			p->pos = slot->len;
+		}
+		if (slot->last)
+		{
+			if (slot->error)
+				return stop_pipeline(-1, slot->err);
+			if (p->carry_len > 0) // the last line has no '\n'
+			{
+				slot->len = 0; // next call: EOF
+				return take_carry(p, ptr, len);
+			}
+			return stop_pipeline(0, 0);
+		}
+		// this buffer is used up: give it back to the reader
+		p->have_slot = 0;
+		atomic_store_explicit(&p->released,
+			atomic_load_explicit(&p->released, memory_order_relaxed) + 1,
+			memory_order_release);
+	}
+}
+
+char	*get_next_line(int fd)
+{
+	const char	*view;
+	size_t		len;
+	char		*line;
+
+	if (gnl_pipelined_next_view(fd, &view, &len) != 1)
+		return NULL;
+	line = malloc(len + 1);
+	if (!line)
+		return NULL;
+	memcpy(line, view, len);
+	line[len] = '\0';
+	return line;
+}
+
+// TESTING: prints the number of lines and bytes of a file (or stdin)
+/* int main(int argc, char **argv)
+{
+	int			fd = 0;
+	const char	*line;
+	size_t		len;
+	size_t		lines = 0;
+	size_t		bytes = 0;
+
+	if (argc == 2)
+		fd = open(argv[1], O_RDONLY);
+	if (fd < 0)
+	{
+		perror("Error opening file");
+		return (1);
+	}
+	while (gnl_pipelined_next_view(fd, &line, &len) == 1)
+	{
+		lines++;
+		bytes += len;
+	}
+	printf("%zu lines, %zu bytes\n", lines, bytes);
+	return (0);
+} */
@@ -1,9 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include "../../common/writer.h"
 
 int *board;         // board[col] = row position of queen in column col
 int board_size;     // size of the board (n)
+t_writer out;       // buffered stdout: one write() for many solutions
 
 // Print the current solution
 void print_solution(void)
@@ -13,13 +15,13 @@ void print_solution(void)
     for (i = 0; i < board_size; i++)
     {
         // Print row position of queen in column i
-        fprintf(stdout, "%d", board[i]);
+        writer_int(&out, board[i]);
         
         // Add space between numbers, except after the last one
         if (i < board_size - 1)
-            fprintf(stdout, " ");
+            writer_char(&out, ' ');
     }
-    fprintf(stdout, "\n");
+    writer_char(&out, '\n');
 }
 
 // replacement abs() function as the original function is not allowed
@@ -93,7 +95,9 @@ int main(int ac, char **av)
 	if (!board)
 		return 1;
 	// Start solving from column 0
+	writer_init(&out, 1);
 	solve(0);
+	writer_flush(&out); // print what is still in the buffer
 	free(board);
 	return 0;
 }
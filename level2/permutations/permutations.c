@@ -2,6 +2,9 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include "../../common/writer.h"
+
+t_writer out; // buffered stdout: one write() for many permutations
 
 /* basic logic of the program: 
 - use factorial function to calculate how many permutations there are 
@@ -104,10 +107,16 @@ void sort_perms(char **all_perms, int total_perms)
 	}
 }
 
-void	print_perms(char **all_perms, int total_perms)
+// same bytes as puts() on every line, collected in one buffer
+void	print_perms(char **all_perms, int total_perms, int size)
 {
+	writer_init(&out, 1);
 	for (int i = 0; i < total_perms; i++)
-		puts(all_perms[i]);
+	{
+		writer_bytes(&out, all_perms[i], size);
+		writer_char(&out, '\n');
+	}
+	writer_flush(&out);
 }
 
 // TO DO: NEEDS TO HANDLE MALLOC FAILURES AND FREE MEMORY
@@ -142,6 +151,6 @@ int main(int ac, char **av)
 	int current_index = 0;
 	generate_all_perms(current_index, size, s, all_perms, &perms_row_index);
 	sort_perms(all_perms, total_perms);
-	print_perms(all_perms, total_perms);
+	print_perms(all_perms, total_perms, size);
 	return 0;
 }
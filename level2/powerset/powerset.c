@@ -1,10 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include "../../common/writer.h"
 
 // define global variables to avoid having to pass variables around
 int required_sum; // integer n
 int size; // the size of the set of integers
 int *nums; // the set of integers
+t_writer out; // buffered stdout: one write() for many subsets
 
 // print the subset, taking its size as parameter
 // (we need to manually keep track of the size of an integer array)
@@ -12,11 +14,11 @@ void	print_subset(int subsize, int *subset)
 {
 	for(int i = 0; i < subsize; i++)
 	{
-		printf("%d", subset[i]);
+		writer_int(&out, subset[i]);
 		if(i < subsize -1 ) // trailing space only if it's not the last integer
-			printf(" ");
+			writer_char(&out, ' ');
 	}
-	printf("\n");
+	writer_char(&out, '\n');
 }
 
 // calculate the actual sum of a given subset
@@ -80,7 +82,9 @@ int main(int ac, char **av)
 	// initialise subset size to 0
 	int subsize = 0;
 	int current_index = 0;
+	writer_init(&out, 1);
 	solve(subsize, current_index, subset);
+	writer_flush(&out); // print what is still in the buffer
 	free(nums);
 	free(subset);
 }
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../../common/writer.h"
+// Remember to compile with the -pthread flag!
+// (e.g. gcc -O2 -pthread powerset_gray_code.c)
+
+/* NOT an exam solution: this version uses pthread and sysconf, which are not in
+the list of allowed functions. It produces exactly the same output as powerset.c
+(same lines, same line order), but it is built for large sets.
+
+Why it is faster than the recursive version:
+- every subset is represented by a bit mask, and we walk the masks in Gray-code
+order. Two consecutive Gray codes differ by exactly ONE bit, so the running sum
+is updated by adding or removing one number instead of re-summing the subset.
+- LANES masks are checked at the same time in one SIMD vector: the lanes only
+differ in a few fixed "lane bits", so they all flip the same bit at every step
+and the whole vector is updated with one vector addition.
+- the highest bits of the mask are fixed per thread, so every thread walks its
+own contiguous slice of the masks.
+
+Canonical order: powerset.c explores "exclude nums[0]" before "include nums[0]",
+then the same for nums[1], and so on. If nums[i] is stored in bit (size - 1 - i)
+of the mask (nums[0] in the highest bit), this is simply ascending mask order.
+Each thread owns a contiguous range of masks, so sorting the matches of every
+thread and printing the threads one after the other restores that order. */
+
+#define LANE_BITS 2 // 2 lane bits -> 4 lanes of long long (one 256-bit vector)
+#define LANES (1 << LANE_BITS)
+#define MAX_THREAD_BITS 6 // at most 64 threads
+#define MAX_SIZE 62 // the masks are stored in unsigned long long
+
+typedef long long t_lanes __attribute__((vector_size(LANES * sizeof(long long))));
+
+// define global variables to avoid having to pass variables around
+long long required_sum; // integer n
+int size; // the size of the set of integers
+int *nums; // the set of integers
+int thread_bits; // number of high mask bits that select the thread
+int lane_bits; // number of mask bits below them that select the SIMD lane
+t_writer out; // buffered stdout: one write() for many subsets
+int gray_bits; // remaining low mask bits, walked in Gray-code order
+
+// the matching masks found by one thread (a growable array)
+typedef struct s_shard
+{
+	pthread_t			thread;
+	unsigned long long	high; // the fixed thread bits, already shifted
+	unsigned long long	*masks;
+	size_t				count;
+	size_t				capacity;
+	int					malloc_failed;
+}	t_shard;
+
+// the number stored at bit position 'bit' of a mask
+int num_at_bit(int bit)
+{
+	return nums[size - 1 - bit];
+}
+
+// sum of the numbers selected by the set bits of 'mask'
+long long mask_sum(unsigned long long mask)
+{
+	long long sum = 0;
+	for (int bit = 0; bit < size; bit++)
+		if (mask & (1ULL << bit))
+			sum += num_at_bit(bit);
+	return sum;
+}
+
+// append a matching mask to the shard, growing the array geometrically
+void shard_push(t_shard *shard, unsigned long long mask)
+{
+	if (shard->count == shard->capacity)
+	{
+		size_t new_capacity = shard->capacity ? shard->capacity * 2 : 64;
+		unsigned long long *tmp = realloc(shard->masks, new_capacity * sizeof(*tmp));
+		if (!tmp)
+		{
+			shard->malloc_failed = 1;
+			return ;
+		}
+		shard->masks = tmp;
+		shard->capacity = new_capacity;
+	}
+	shard->masks[shard->count++] = mask;
+}
+
+// worker: walk every mask whose high bits equal shard->high
+void *walk_shard(void *arg)
+{
+	t_shard *shard = arg;
+	t_lanes sums;
+	t_lanes valid;
+	t_lanes target;
+	unsigned long long steps = 1ULL << gray_bits;
+	unsigned long long gray = 0;
+
+	// lane j starts with the thread bits and the lane bits set to j;
+	// lanes that do not exist (fewer lane bits than LANE_BITS) are never reported
+	for (int j = 0; j < LANES; j++)
+	{
+		sums[j] = mask_sum(shard->high | ((unsigned long long)j << gray_bits));
+		valid[j] = (j < (1 << lane_bits)) ? -1 : 0;
+		target[j] = required_sum;
+	}
+	for (unsigned long long k = 0; k < steps; k++)
+	{
+		if (k > 0)
+		{
+			// Gray code of k differs from the previous one by the lowest set bit of k
+			int bit = __builtin_ctzll(k);
+			long long delta = num_at_bit(bit);
+			gray ^= 1ULL << bit;
+			if (!(gray & (1ULL << bit)))
+				delta = -delta;
+			sums += delta; // one vector addition updates all the lanes
+		}
+		t_lanes hits = (sums == target) & valid;
+		long long any = 0;
+		for (int j = 0; j < LANES; j++)
+			any |= hits[j];
+		if (any)
+		{
+			for (int j = 0; j < LANES; j++)
+				if (hits[j])
+					shard_push(shard, shard->high | ((unsigned long long)j << gray_bits) | gray);
+			if (shard->malloc_failed)
+				return NULL;
+		}
+	}
+	return NULL;
+}
+
+int compare_masks(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+	return (x > y) - (x < y);
+}
+
+// print the subset stored in a mask, in the order of the given set
+void print_subset(unsigned long long mask)
+{
+	int printed = 0;
+	for (int i = 0; i < size; i++)
+	{
+		if (mask & (1ULL << (size - 1 - i)))
+		{
+			if (printed) // no trailing space
+				writer_char(&out, ' ');
+			writer_int(&out, nums[i]);
+			printed = 1;
+		}
+	}
+	writer_char(&out, '\n');
+}
+
+// choose how many threads to use: a power of two, at most one per CPU
+int choose_thread_bits(void)
+{
+	long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int bits = 0;
+	while (bits < MAX_THREAD_BITS && (2L << bits) <= cpus && bits + lane_bits + 1 <= size)
+		bits++;
+	return bits;
+}
+
+// NOTE: The actual error handling requirements in the exam may be different!!!!!!!
+int main(int ac, char **av)
+{
+	// error handling: no arguments; just the required sum and no integer set
+	if (ac <= 2)
+	{
+		printf("\n");
+		return 0;
+	}
+	required_sum = atoi(av[1]);
+	size = ac - 2;
+	if (size > MAX_SIZE) // 2^63 subsets could never be enumerated anyway
+		return 1;
+	nums = malloc(sizeof(int) * size);
+	if (!nums)
+		return 1;
+	for (int i = 0; i < size; i++)
+		nums[i] = atoi(av[i + 2]);
+
+	// split the mask: [ thread bits | lane bits | gray bits ]
+	lane_bits = size < LANE_BITS ? size : LANE_BITS;
+	thread_bits = choose_thread_bits();
+	gray_bits = size - lane_bits - thread_bits;
+	int nthreads = 1 << thread_bits;
+	t_shard *shards = calloc(nthreads, sizeof(t_shard));
+	if (!shards)
+	{
+		free(nums);
+		return 1;
+	}
+	for (int t = 0; t < nthreads; t++)
+	{
+		shards[t].high = (unsigned long long)t << (lane_bits + gray_bits);
+		// if a thread cannot be created, do its share on the main thread
+		if (pthread_create(&shards[t].thread, NULL, walk_shard, &shards[t]) != 0)
+		{
+			walk_shard(&shards[t]);
+			shards[t].thread = pthread_self();
+		}
+	}
+	int malloc_failed = 0;
+	for (int t = 0; t < nthreads; t++)
+	{
+		if (!pthread_equal(shards[t].thread, pthread_self()))
+			pthread_join(shards[t].thread, NULL);
+		malloc_failed |= shards[t].malloc_failed;
+	}
+	// print the matches of each shard in ascending mask order (skipping the empty set)
+	writer_init(&out, 1);
+	for (int t = 0; t < nthreads && !malloc_failed; t++)
+	{
+		qsort(shards[t].masks, shards[t].count, sizeof(unsigned long long), compare_masks);
+		for (size_t i = 0; i < shards[t].count; i++)
+			if (shards[t].masks[i] != 0)
+				print_subset(shards[t].masks[i]);
+	}
+	writer_flush(&out);
+	for (int t = 0; t < nthreads; t++)
+		free(shards[t].masks);
+	free(shards);
+	free(nums);
+	return malloc_failed;
+}
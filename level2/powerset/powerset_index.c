@@ -0,0 +1,490 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../common/writer.h"
+
+/* NOT an exam solution: a subset-sum "index" for when the same set of integers
+is checked against many different required sums.
+
+Usage:
+	./powerset_index build <index_file> <n1> <n2> ...
+	./powerset_index query <index_file> [--list] < targets
+
+"build" does all the expensive work once and saves it to <index_file>:
+- the set is split in two halves, and the sums of all the subsets of each half
+are stored in two tables sorted by sum ("meet in the middle").
+- if the possible sums fit in a bounded range (at most COUNT_TABLE_MAX values),
+a table with the number of subsets for every possible sum is stored as well.
+- otherwise, if the whole set has at most SUM_TABLE_MAX subsets (22 integers),
+its distinct subset sums are stored sorted, each with its number of subsets.
+
+"query" maps the index file into memory (no parsing, no copying) and reads the
+required sums from stdin, one per whitespace-separated integer:
+- without --list it prints one line per target: the number of non-empty subsets
+whose sum is the target. With the count table this is a single array look-up,
+with the sum table a binary search (O(size)). Without both, that is for more
+than 22 integers with widely spread values, there is no table small enough to
+store: we walk the two sorted half tables once, O(2^(size/2)) for every query
+(about 16M steps for 48 integers).
+- with --list it prints the matching subsets exactly like powerset.c (same
+lines, same order), followed by an empty line that ends the answer for that
+target. For every subset sum of the first half, a binary search in the second
+half finds the sums that complete it, so the cost is O(2^(size/2) * log) plus
+the size of the output. The subsets are sorted in memory first: a target with
+more than LIST_MAX of them is refused with an error (and the query stops). */
+
+#define INDEX_MAGIC "PSIDX02"
+#define MAX_SIZE 48 // 2^24 subsets per half, 16 bytes each
+#define COUNT_TABLE_MAX (1LL << 22) // at most 4M possible sums (32 MB of counts)
+#define SUM_TABLE_MAX (1LL << 22) // at most 4M subsets (64 MB of sums)
+#define LIST_MAX (1ULL << 24) // at most 16M subsets listed per target (128 MB)
+
+// file layout: header, nums (padded to 8 bytes), counts, sums, left table, right table
+typedef struct s_index_header
+{
+	char		magic[8];
+	int			size; // the size of the set of integers
+	int			half; // nums[0..half-1] are in the left table, the rest in the right one
+	long long	min_sum; // the sum stored in counts[0]
+	long long	table_len; // number of entries of the count table, 0 if there is none
+	long long	sums_len; // number of entries of the sum table, 0 if there is none
+	long long	left_len; // 2^half
+	long long	right_len; // 2^(size - half)
+}	t_index_header;
+
+// the sum of one subset of a half, and which numbers of that half it contains
+typedef struct s_half_sum
+{
+	long long			sum;
+	unsigned long long	mask;
+}	t_half_sum;
+
+// a distinct subset sum of the whole set and the number of subsets giving it
+typedef struct s_sum_count
+{
+	long long			sum;
+	unsigned long long	count;
+}	t_sum_count;
+
+// a read-only view of an index file mapped in memory
+typedef struct s_index
+{
+	const t_index_header		*header;
+	const int					*nums;
+	const unsigned long long	*counts;
+	const t_sum_count			*sums;
+	const t_half_sum			*left;
+	const t_half_sum			*right;
+	void						*map;
+	size_t						map_len;
+}	t_index;
+
+size_t nums_bytes(int size)
+{
+	return ((sizeof(int) * size + 7) / 8) * 8;
+}
+
+size_t index_bytes(const t_index_header *h)
+{
+	return sizeof(*h) + nums_bytes(h->size) + sizeof(unsigned long long) * h->table_len
+		+ sizeof(t_sum_count) * h->sums_len + sizeof(t_half_sum) * (h->left_len + h->right_len);
+}
+
+int compare_half_sums(const void *a, const void *b)
+{
+	const t_half_sum *x = a;
+	const t_half_sum *y = b;
+	if (x->sum != y->sum)
+		return (x->sum > y->sum) - (x->sum < y->sum);
+	return (x->mask > y->mask) - (x->mask < y->mask);
+}
+
+int compare_masks(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+	return (x > y) - (x < y);
+}
+
+// sums of all the subsets of nums[0..count-1], sorted by sum.
+// nums[i] is stored in bit (count - 1 - i) of the mask, like in powerset_gray_code.c
+t_half_sum *build_half(const int *nums, int count)
+{
+	long long len = 1LL << count;
+	t_half_sum *table = malloc(sizeof(t_half_sum) * len);
+	if (!table)
+		return NULL;
+	table[0].sum = 0;
+	table[0].mask = 0;
+	// each subset = a smaller subset (lowest bit removed) + one number
+	for (long long mask = 1; mask < len; mask++)
+	{
+		int bit = __builtin_ctzll(mask);
+		table[mask].mask = mask;
+		table[mask].sum = table[mask & (mask - 1)].sum + nums[count - 1 - bit];
+	}
+	qsort(table, len, sizeof(t_half_sum), compare_half_sums);
+	return table;
+}
+
+// counts[s - min_sum] = number of subsets (including the empty one) whose sum is s.
+// Classic 0/1 knapsack counting; *counts stays NULL when the range is too large.
+// Returns -1 if out of memory.
+int build_counts(const int *nums, int size, unsigned long long **counts_out,
+	long long *min_sum, long long *table_len)
+{
+	long long lo = 0;
+	long long hi = 0;
+	for (int i = 0; i < size; i++)
+	{
+		if (nums[i] < 0)
+			lo += nums[i];
+		else
+			hi += nums[i];
+	}
+	*counts_out = NULL;
+	*min_sum = lo;
+	*table_len = 0;
+	if (hi - lo + 1 > COUNT_TABLE_MAX)
+		return 0;
+	long long len = hi - lo + 1;
+	unsigned long long *counts = calloc(len, sizeof(unsigned long long));
+	if (!counts)
+		return -1;
+	counts[-lo] = 1; // the empty subset
+	for (int i = 0; i < size; i++)
+	{
+		long long x = nums[i];
+		// walk away from the shift direction so every number is used at most once
+		if (x > 0)
+			for (long long s = len - 1; s >= x; s--)
+				counts[s] += counts[s - x];
+		else if (x < 0)
+			for (long long s = 0; s < len + x; s++)
+				counts[s] += counts[s - x];
+		else
+			for (long long s = 0; s < len; s++)
+				counts[s] *= 2;
+	}
+	*counts_out = counts;
+	*table_len = len;
+	return 0;
+}
+
+// the distinct subset sums of the whole set, sorted, with their number of
+// subsets (the empty one included); *sums stays NULL when there are too many
+// subsets. Returns -1 if out of memory.
+int build_sums(const int *nums, int size, t_sum_count **sums_out, long long *sums_len)
+{
+	*sums_out = NULL;
+	*sums_len = 0;
+	if ((1LL << size) > SUM_TABLE_MAX)
+		return 0;
+	t_half_sum *all = build_half(nums, size);
+	if (!all)
+		return -1;
+	long long len = 0;
+	for (long long i = 0; i < (1LL << size); i++)
+		if (i == 0 || all[i].sum != all[i - 1].sum)
+			len++;
+	t_sum_count *sums = malloc(sizeof(t_sum_count) * len);
+	if (!sums)
+	{
+		free(all);
+		return -1;
+	}
+	long long k = -1;
+	for (long long i = 0; i < (1LL << size); i++)
+	{
+		if (i == 0 || all[i].sum != all[i - 1].sum)
+		{
+			sums[++k].sum = all[i].sum;
+			sums[k].count = 0;
+		}
+		sums[k].count++;
+	}
+	free(all);
+	*sums_out = sums;
+	*sums_len = len;
+	return 0;
+}
+
+int build_index(const char *path, int size, char **args)
+{
+	t_index_header header;
+	int *nums = calloc(nums_bytes(size) / sizeof(int) + 1, sizeof(int));
+	if (!nums)
+	{
+		fprintf(stderr, "Error: out of memory\n");
+		return 1;
+	}
+	for (int i = 0; i < size; i++)
+		nums[i] = atoi(args[i]);
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+	header.size = size;
+	header.half = size / 2;
+	header.left_len = 1LL << header.half;
+	header.right_len = 1LL << (size - header.half);
+	unsigned long long *counts = NULL;
+	t_sum_count *sums = NULL;
+	int failed = build_counts(nums, size, &counts, &header.min_sum, &header.table_len) != 0;
+	if (!failed && !counts) // no count table: the sum table, if not too large
+		failed = build_sums(nums, size, &sums, &header.sums_len) != 0;
+	t_half_sum *left = build_half(nums, header.half);
+	t_half_sum *right = build_half(nums + header.half, size - header.half);
+	int ret = 1;
+	FILE *file = NULL;
+	if (failed || !left || !right)
+		fprintf(stderr, "Error: out of memory\n");
+	else if ((file = fopen(path, "wb")) == NULL)
+		perror(path);
+	else
+	{
+		if (fwrite(&header, sizeof(header), 1, file) == 1
+			&& fwrite(nums, 1, nums_bytes(size), file) == nums_bytes(size)
+			&& fwrite(counts, sizeof(*counts), header.table_len, file) == (size_t)header.table_len
+			&& fwrite(sums, sizeof(*sums), header.sums_len, file) == (size_t)header.sums_len
+			&& fwrite(left, sizeof(*left), header.left_len, file) == (size_t)header.left_len
+			&& fwrite(right, sizeof(*right), header.right_len, file) == (size_t)header.right_len)
+			ret = 0;
+		if (fclose(file) != 0)
+			ret = 1;
+		if (ret)
+			perror(path);
+	}
+	free(nums);
+	free(counts);
+	free(sums);
+	free(left);
+	free(right);
+	return ret;
+}
+
+// map an index file read-only and point the tables into the mapping
+int open_index(const char *path, t_index *index)
+{
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(t_index_header))
+	{
+		if (fd >= 0)
+			close(fd);
+		return -1;
+	}
+	index->map_len = st.st_size;
+	index->map = mmap(NULL, index->map_len, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd); // the mapping stays valid after close
+	if (index->map == MAP_FAILED)
+		return -1;
+	const char *p = index->map;
+	const t_index_header *h = (const t_index_header *)p;
+	index->header = h;
+	// every field is checked before index_bytes() trusts them
+	if (memcmp(h->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0
+		|| h->size < 0 || h->size > MAX_SIZE
+		|| h->half < 0 || h->half > h->size
+		|| h->left_len != 1LL << h->half || h->right_len != 1LL << (h->size - h->half)
+		|| h->min_sum > 0 || h->min_sum < (long long)h->size * INT_MIN
+		|| h->table_len < 0 || h->table_len > COUNT_TABLE_MAX
+		|| h->sums_len < 0 || h->sums_len > SUM_TABLE_MAX
+		|| index_bytes(h) != index->map_len)
+	{
+		munmap(index->map, index->map_len);
+		return -1;
+	}
+	p += sizeof(t_index_header);
+	index->nums = (const int *)p;
+	p += nums_bytes(index->header->size);
+	index->counts = (const unsigned long long *)p;
+	p += sizeof(unsigned long long) * index->header->table_len;
+	index->sums = (const t_sum_count *)p;
+	p += sizeof(t_sum_count) * index->header->sums_len;
+	index->left = (const t_half_sum *)p;
+	index->right = index->left + index->header->left_len;
+	return 0;
+}
+
+// first position in the sorted half table whose sum is >= sum
+long long lower_bound(const t_half_sum *table, long long len, long long sum)
+{
+	long long lo = 0;
+	long long hi = len;
+	while (lo < hi)
+	{
+		long long mid = lo + (hi - lo) / 2;
+		if (table[mid].sum < sum)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+// number of subsets (including the empty one) that sum to target
+unsigned long long count_subsets(const t_index *index, long long target)
+{
+	const t_index_header *h = index->header;
+	if (h->table_len)
+	{
+		if (target < h->min_sum || target >= h->min_sum + h->table_len)
+			return 0;
+		return index->counts[target - h->min_sum];
+	}
+	if (h->sums_len)
+	{
+		// binary search in the distinct sums
+		long long lo = 0;
+		long long hi = h->sums_len;
+		while (lo < hi)
+		{
+			long long mid = lo + (hi - lo) / 2;
+			if (index->sums[mid].sum < target)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		if (lo < h->sums_len && index->sums[lo].sum == target)
+			return index->sums[lo].count;
+		return 0;
+	}
+	// walk left upwards and right downwards, multiplying runs of equal sums
+	unsigned long long total = 0;
+	long long i = 0;
+	long long j = h->right_len - 1;
+	while (i < h->left_len && j >= 0)
+	{
+		long long sum = index->left[i].sum + index->right[j].sum;
+		if (sum < target)
+			i++;
+		else if (sum > target)
+			j--;
+		else
+		{
+			long long left_run = 0;
+			long long right_run = 0;
+			long long left_sum = index->left[i].sum;
+			long long right_sum = index->right[j].sum;
+			while (i < h->left_len && index->left[i].sum == left_sum)
+			{
+				left_run++;
+				i++;
+			}
+			while (j >= 0 && index->right[j].sum == right_sum)
+			{
+				right_run++;
+				j--;
+			}
+			total += (unsigned long long)left_run * right_run;
+		}
+	}
+	return total;
+}
+
+t_writer out; // buffered stdout for --list (the counts go through printf)
+
+// print the subset stored in a mask, in the order of the given set
+void print_subset(const t_index *index, unsigned long long mask)
+{
+	int size = index->header->size;
+	int printed = 0;
+	for (int i = 0; i < size; i++)
+	{
+		if (mask & (1ULL << (size - 1 - i)))
+		{
+			if (printed) // no trailing space
+				writer_char(&out, ' ');
+			writer_int(&out, index->nums[i]);
+			printed = 1;
+		}
+	}
+	writer_char(&out, '\n');
+}
+
+// print all the non-empty subsets summing to target, in the order of powerset.c;
+// -1 (with a message) if there are too many of them to sort in memory
+int list_subsets(const t_index *index, long long target)
+{
+	const t_index_header *h = index->header;
+	unsigned long long count = count_subsets(index, target);
+	if (count > LIST_MAX)
+	{
+		fprintf(stderr, "Error: %llu subsets sum to %lld, --list prints at most %llu\n",
+			count - (target == 0), target, LIST_MAX);
+		return -1;
+	}
+	unsigned long long *masks = malloc(sizeof(unsigned long long) * (count ? count : 1));
+	if (!masks)
+	{
+		fprintf(stderr, "Error: out of memory\n");
+		return -1;
+	}
+	unsigned long long found = 0;
+	int right_bits = h->size - h->half;
+	for (long long i = 0; i < h->left_len; i++)
+	{
+		long long need = target - index->left[i].sum;
+		for (long long j = lower_bound(index->right, h->right_len, need);
+			j < h->right_len && index->right[j].sum == need; j++)
+			masks[found++] = (index->left[i].mask << right_bits) | index->right[j].mask;
+	}
+	qsort(masks, found, sizeof(unsigned long long), compare_masks);
+	writer_init(&out, 1);
+	for (unsigned long long k = 0; k < found; k++)
+		if (masks[k] != 0) // skip the empty set
+			print_subset(index, masks[k]);
+	writer_char(&out, '\n');
+	writer_flush(&out); // the whole answer before the next query is read
+	free(masks);
+	return 0;
+}
+
+int query_index(const char *path, int list)
+{
+	t_index index;
+	long long target;
+	if (open_index(path, &index) != 0)
+	{
+		fprintf(stderr, "Error: %s is not a valid index file\n", path);
+		return 1;
+	}
+	int ret = 0;
+	while (scanf("%lld", &target) == 1)
+	{
+		if (list)
+		{
+			if (list_subsets(&index, target) != 0)
+			{
+				ret = 1;
+				break ;
+			}
+		}
+		else
+			printf("%llu\n", count_subsets(&index, target) - (target == 0)); // no empty set
+	}
+	munmap(index.map, index.map_len);
+	return ret;
+}
+
+int main(int ac, char **av)
+{
+	if (ac >= 3 && strcmp(av[1], "build") == 0)
+	{
+		if (ac - 3 > MAX_SIZE)
+		{
+			fprintf(stderr, "Error: at most %d integers can be indexed\n", MAX_SIZE);
+			return 1;
+		}
+		return build_index(av[2], ac - 3, av + 3);
+	}
+	if ((ac == 3 || (ac == 4 && strcmp(av[3], "--list") == 0)) && strcmp(av[1], "query") == 0)
+		return query_index(av[2], ac == 4);
+	fprintf(stderr, "usage: %s build <index_file> <n1> <n2> ...\n", av[0]);
+	fprintf(stderr, "       %s query <index_file> [--list] < targets\n", av[0]);
+	return 1;
+}
@@ -1,5 +1,15 @@
 #include <unistd.h>
 #include <stdio.h>
+#include "../../common/writer.h"
+
+t_writer out; // buffered stdout: one write() for many solutions
+
+// puts(s), into the buffer
+void put_line(char *s)
+{
+	writer_str(&out, s);
+	writer_char(&out, '\n');
+}
 
 int ft_strlen(char *s)
 {
@@ -34,7 +44,7 @@ void solve(int current_index, int total_to_remove, int num_removed, char *s)
 	if (current_index == ft_strlen(s))
 	{
 		if (num_removed == total_to_remove && !min_to_remove(s))
-			puts(s);
+			put_line(s);
 		return ;
 	}
 	 // Early termination: if we've already removed too many
@@ -63,14 +73,13 @@ int main(int argc, char **argv)
 		return 0;
 	}
 	char *s = argv[1];
+	writer_init(&out, 1);
 	// checking if already balanced
 	if (!min_to_remove(s))
-	{
-		puts(s);
-		return 0;
-	}
-	// recursive solve
-	solve(0, min_to_remove(s), 0, s);
+		put_line(s);
+	else // recursive solve
+		solve(0, min_to_remove(s), 0, s);
+	writer_flush(&out); // print what is still in the buffer
 	return 0;
 }
 
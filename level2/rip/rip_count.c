@@ -0,0 +1,290 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "../../common/writer.h"
+
+/* NOT an exam solution (uses malloc, printf, strcmp...): a dynamic-programming
+version of rip for long strings, where the number of solutions explodes.
+
+Usage:
+	./rip_count 'string'             prints all the solutions (same order as rip.c)
+	./rip_count --limit N 'string'   prints only the first N solutions (none for 0)
+	./rip_count --count 'string'     prints how many solutions there are
+
+Structure of the minimal solutions:
+Let p(i) be the balance of the first i characters (number of '(' minus number
+of ')'), let m be the smallest value of p and k the LAST position where p(k) == m.
+Every minimal solution removes exactly -m ')' before position k and nothing else
+there, and exactly p(len) - m '(' from position k onwards and nothing else there
+(removing anything more would not be minimal). So each bracket has at most one
+"removable" type, and the number of removals used so far is fully determined by
+the position and the current balance: the DP state is just (position, balance).
+
+- can[i][b] (one bit): from position i with balance b, a valid solution can still
+be completed. Computed backwards, with the extra rule that the balance must be 0
+at position k. The enumerator only follows moves that land on a "can" state, so
+every step of the search leads to a printed solution (no dead ends).
+- the number of solutions is counted forwards over the same states with big
+integers (it can be far larger than 2^64), without enumerating anything. */
+
+// the string being solved, its length and the split position
+char *s;
+int len;
+int split;
+int max_balance; // the balance can never be larger than the number of '('
+
+// feasibility bits: row i holds the bits for balance 0..max_balance
+unsigned char *can;
+size_t row_bytes;
+
+int has_limit; // --limit was given (N can be 0: nothing is printed)
+unsigned long long limit;
+unsigned long long printed;
+t_writer out; // buffered stdout for the solutions (the count goes through printf)
+
+int can_get(int i, int b)
+{
+	if (b < 0 || b > max_balance)
+		return 0;
+	return (can[(size_t)i * row_bytes + b / 8] >> (b % 8)) & 1;
+}
+
+void can_set(int i, int b)
+{
+	can[(size_t)i * row_bytes + b / 8] |= 1 << (b % 8);
+}
+
+// a bracket at position i may be removed only if it is of the removable type of its side
+int is_removable(int i)
+{
+	if (i < split)
+		return s[i] == ')';
+	return s[i] == '(';
+}
+
+// balance after keeping the character at position i
+int kept_balance(int i, int b)
+{
+	if (s[i] == '(')
+		return b + 1;
+	if (s[i] == ')')
+		return b - 1;
+	return b;
+}
+
+void find_split(void)
+{
+	int balance = 0, min = 0;
+	split = 0;
+	max_balance = 0;
+	for (int i = 0; i < len; i++)
+	{
+		if (s[i] == '(')
+		{
+			balance++;
+			max_balance++;
+		}
+		else if (s[i] == ')')
+			balance--;
+		if (balance <= min) // "<=": we want the last position of the minimum
+		{
+			min = balance;
+			split = i + 1;
+		}
+	}
+}
+
+int build_can(void)
+{
+	row_bytes = max_balance / 8 + 1;
+	can = calloc((size_t)(len + 1) * row_bytes, 1);
+	if (!can)
+		return -1;
+	can_set(len, 0);
+	for (int i = len - 1; i >= 0; i--)
+	{
+		for (int b = 0; b <= max_balance; b++)
+		{
+			if (can_get(i + 1, kept_balance(i, b)) || (is_removable(i) && can_get(i + 1, b)))
+				can_set(i, b);
+		}
+		if (i == split && i > 0) // the prefix must end balanced
+		{
+			int balanced = can_get(i, 0);
+			memset(can + (size_t)i * row_bytes, 0, row_bytes);
+			if (balanced)
+				can_set(i, 0);
+		}
+	}
+	return 0;
+}
+
+/* --- big integers: little-endian arrays of 32-bit limbs --- */
+
+int limbs; // capacity of every big integer (enough for 2^len)
+
+void big_add(unsigned int *dst, const unsigned int *src, int used)
+{
+	unsigned long long carry = 0;
+	for (int j = 0; j < used; j++)
+	{
+		carry += (unsigned long long)dst[j] + src[j];
+		dst[j] = (unsigned int)carry;
+		carry >>= 32;
+	}
+	if (carry && used < limbs)
+		dst[used] += (unsigned int)carry;
+}
+
+// print a big integer in decimal (destroys its value)
+int big_print(unsigned int *n, int used)
+{
+	// 1e9 per chunk; a number of 'used' limbs has at most 10 * used decimal digits
+	unsigned int *chunks = malloc(sizeof(unsigned int) * (used * 10 / 9 + 2));
+	if (!chunks)
+		return -1;
+	int count = 0;
+	while (used > 0 && n[used - 1] == 0)
+		used--;
+	do
+	{
+		unsigned long long rem = 0;
+		for (int j = used - 1; j >= 0; j--)
+		{
+			unsigned long long cur = (rem << 32) | n[j];
+			n[j] = (unsigned int)(cur / 1000000000);
+			rem = cur % 1000000000;
+		}
+		chunks[count++] = (unsigned int)rem;
+		while (used > 0 && n[used - 1] == 0)
+			used--;
+	} while (used > 0);
+	printf("%u", chunks[count - 1]);
+	for (int j = count - 2; j >= 0; j--)
+		printf("%09u", chunks[j]);
+	printf("\n");
+	free(chunks);
+	return 0;
+}
+
+// number of solutions: forward DP over the feasible states, two rows of big integers
+int count_solutions(void)
+{
+	limbs = len / 32 + 2;
+	size_t row = (size_t)(max_balance + 2) * limbs;
+	unsigned int *cur = calloc(row, sizeof(unsigned int));
+	unsigned int *next = calloc(row, sizeof(unsigned int));
+	if (!cur || !next)
+	{
+		free(cur);
+		free(next);
+		return -1;
+	}
+	cur[0] = 1; // one way to stand at position 0 with balance 0
+	for (int i = 0; i < len; i++)
+	{
+		// after i characters every count is at most 2^i and every balance at most i
+		int used = i / 32 + 1;
+		int top = i < max_balance ? i : max_balance;
+		memset(next, 0, row * sizeof(unsigned int));
+		for (int b = 0; b <= top; b++)
+		{
+			if (!can_get(i, b))
+				continue ;
+			unsigned int *ways = cur + (size_t)b * limbs;
+			int nb = kept_balance(i, b);
+			if (can_get(i + 1, nb))
+				big_add(next + (size_t)nb * limbs, ways, used);
+			if (is_removable(i) && can_get(i + 1, b))
+				big_add(next + (size_t)b * limbs, ways, used);
+		}
+		unsigned int *tmp = cur;
+		cur = next;
+		next = tmp;
+	}
+	int ret = big_print(cur, limbs);
+	free(cur);
+	free(next);
+	return ret;
+}
+
+// N of --limit N: digits only, no sign and no overflow; -1 if it is not one
+int parse_limit(const char *str)
+{
+	char *end;
+	if (*str < '0' || *str > '9')
+		return -1;
+	errno = 0;
+	limit = strtoull(str, &end, 10);
+	if (*end != '\0' || errno == ERANGE)
+		return -1;
+	has_limit = 1;
+	return 0;
+}
+
+// enumerate the solutions; every call is on a feasible state
+void solve(int i, int b)
+{
+	if (has_limit && printed >= limit)
+		return ;
+	if (i == len)
+	{
+		writer_bytes(&out, s, len); // puts(s), without looking for the '\0'
+		writer_char(&out, '\n');
+		printed++;
+		return ;
+	}
+	// option 1: remove it
+	if (is_removable(i) && can_get(i + 1, b))
+	{
+		char temp = s[i];
+		s[i] = ' ';
+		solve(i + 1, b);
+		s[i] = temp;
+	}
+	// option 2: keep it
+	int nb = kept_balance(i, b);
+	if (can_get(i + 1, nb))
+		solve(i + 1, nb);
+}
+
+int main(int argc, char **argv)
+{
+	int count_only = 0;
+	int arg = 1;
+	while (arg < argc - 1)
+	{
+		if (strcmp(argv[arg], "--count") == 0)
+			count_only = 1;
+		else if (strcmp(argv[arg], "--limit") == 0 && arg + 1 < argc - 1
+			&& parse_limit(argv[arg + 1]) == 0)
+			arg++;
+		else
+			break ;
+		arg++;
+	}
+	// error handling for incorrect arguments, a bad N too (same as rip.c)
+	if (arg != argc - 1)
+	{
+		write(1, "\n", 1);
+		return 0;
+	}
+	s = argv[arg];
+	len = strlen(s);
+	find_split();
+	if (build_can() != 0)
+		return 1;
+	int ret = 0;
+	if (count_only)
+		ret = count_solutions() != 0;
+	else if (can_get(0, 0))
+	{
+		writer_init(&out, 1);
+		solve(0, 0);
+		writer_flush(&out);
+	}
+	free(can);
+	return ret;
+}
@@ -0,0 +1,419 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+// Remember to compile with the -pthread flag!
+
+/* NOT an exam solution: a multi-threaded version of rip_pruned.c, for strings
+with millions of solutions where both the search and the output are too slow
+on one core.
+
+Usage:
+	./rip_parallel [-j threads] [--unordered] 'string'
+
+- the decision tree is split at the first brackets: every feasible way of
+removing/keeping them becomes one task, listed in the order rip.c would visit
+them. Worker threads take tasks one at a time.
+- every worker solves on its own copy of the string, so nothing is shared
+during the search, and appends the solutions to a large private buffer
+instead of calling puts() once per line.
+- by default the output is in the same order as rip.c: a full buffer is handed
+to its task, and the main thread writes the tasks strictly in order (the task
+being written is streamed while it is still running). Workers that get too far
+ahead wait until the main thread catches up, so memory stays bounded.
+- with --unordered a full buffer is written straight away (under a lock, so
+lines are never mixed); the order of the lines is then not deterministic,
+which the subject allows. */
+
+#define CHUNK_SIZE (1 << 20) // at least 1 MB of private output buffer per worker
+#define MAX_BUFFERED_CHUNKS 64 // ordered mode: output kept in memory, per worker
+#define TASKS_PER_THREAD 16
+#define MAX_SPLIT_BRACKETS 24 // the choices of a task fit in an unsigned int
+
+// a filled output buffer
+typedef struct s_chunk
+{
+	struct s_chunk	*next;
+	size_t			len;
+	char			data[]; // chunk_size bytes
+}	t_chunk;
+
+// a subtree of the search: the state of rip_pruned.c's solve() after the split
+typedef struct s_task
+{
+	int				i;
+	int				balance;
+	int				open_budget;
+	int				close_budget;
+	int				opens_left;
+	int				closes_left;
+	unsigned int	removed; // bit d set: the d-th bracket of the string was removed
+	t_chunk			*head; // ordered mode: output waiting to be written
+	t_chunk			*tail;
+	int				done;
+}	t_task;
+
+typedef struct s_worker
+{
+	pthread_t	thread;
+	char		*s; // private copy of the string
+	t_chunk		*out; // private output buffer
+	t_task		*task; // the task being solved
+}	t_worker;
+
+// the string being solved and its length
+char *input;
+int len;
+size_t chunk_size; // CHUNK_SIZE, or more if a single line would not fit
+int brackets[MAX_SPLIT_BRACKETS]; // positions of the first brackets (the split)
+int split_count;
+
+t_task *tasks;
+int ntasks;
+int task_capacity;
+int next_task; // next task to hand out (taken under 'lock')
+int writing; // ordered mode: the task the main thread is writing
+int buffered; // ordered mode: chunks handed over but not written yet
+int max_buffered;
+int unordered;
+int failed; // a malloc failed somewhere (set under 'lock' by the workers)
+
+pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t progress = PTHREAD_COND_INITIALIZER;
+
+void write_all(const char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t ret = write(1, buf, len);
+		if (ret <= 0)
+			return ;
+		buf += ret;
+		len -= ret;
+	}
+}
+
+// split the unmatched brackets into '(' to remove and ')' to remove
+void count_to_remove(int *open_budget, int *close_budget)
+{
+	int open = 0, close = 0;
+	for (int i = 0; input[i]; i++)
+	{
+		if (input[i] == '(')
+			open++;
+		else if (input[i] == ')')
+		{
+			if (open > 0)
+				open--;
+			else
+				close++;
+		}
+	}
+	*open_budget = open;
+	*close_budget = close;
+}
+
+void push_task(t_task *task)
+{
+	if (ntasks == task_capacity)
+	{
+		int new_capacity = task_capacity ? task_capacity * 2 : 64;
+		t_task *tmp = realloc(tasks, sizeof(t_task) * new_capacity);
+		if (!tmp)
+		{
+			failed = 1;
+			return ;
+		}
+		tasks = tmp;
+		task_capacity = new_capacity;
+	}
+	tasks[ntasks++] = *task;
+}
+
+// same search as rip_pruned.c, stopping after 'depth' brackets to record a task
+void split_tasks(t_task task, int depth)
+{
+	while (task.i < len && input[task.i] != '(' && input[task.i] != ')')
+		task.i++;
+	if (task.i == len || depth == split_count)
+	{
+		push_task(&task);
+		return ;
+	}
+	t_task next = task;
+	next.i = task.i + 1;
+	if (input[task.i] == '(')
+	{
+		next.opens_left--;
+		if (task.open_budget > 0)
+		{
+			next.open_budget--;
+			next.removed |= 1u << depth;
+			split_tasks(next, depth + 1);
+			next.open_budget++;
+			next.removed = task.removed;
+		}
+		next.balance++;
+		if (task.open_budget <= task.opens_left - 1)
+			split_tasks(next, depth + 1);
+	}
+	else
+	{
+		next.closes_left--;
+		if (task.close_budget > 0)
+		{
+			next.close_budget--;
+			next.removed |= 1u << depth;
+			split_tasks(next, depth + 1);
+			next.close_budget++;
+			next.removed = task.removed;
+		}
+		next.balance--;
+		if (task.balance > 0 && task.close_budget <= task.closes_left - 1)
+			split_tasks(next, depth + 1);
+	}
+}
+
+t_chunk *new_chunk(void)
+{
+	t_chunk *chunk = malloc(sizeof(t_chunk) + chunk_size);
+	if (!chunk)
+	{
+		pthread_mutex_lock(&lock); // several workers may fail at once
+		failed = 1;
+		pthread_mutex_unlock(&lock);
+	}
+	else
+	{
+		chunk->next = NULL;
+		chunk->len = 0;
+	}
+	return chunk;
+}
+
+// hand the worker's full buffer over: to the output directly, or to its task
+void flush_worker(t_worker *w)
+{
+	if (!w->out || w->out->len == 0)
+		return ;
+	if (unordered)
+	{
+		pthread_mutex_lock(&lock);
+		write_all(w->out->data, w->out->len);
+		pthread_mutex_unlock(&lock);
+		w->out->len = 0;
+		return ;
+	}
+	pthread_mutex_lock(&lock);
+	// the task being written never waits, so the main thread always makes progress
+	while (buffered >= max_buffered && w->task != &tasks[writing])
+		pthread_cond_wait(&progress, &lock);
+	buffered++;
+	if (w->task->tail)
+		w->task->tail->next = w->out;
+	else
+		w->task->head = w->out;
+	w->task->tail = w->out;
+	pthread_cond_broadcast(&progress);
+	pthread_mutex_unlock(&lock);
+	w->out = new_chunk();
+}
+
+void emit(t_worker *w)
+{
+	if (w->out && w->out->len + len + 1 > chunk_size)
+		flush_worker(w);
+	if (!w->out) // out of memory: the output is lost and we exit with 1
+		return ;
+	memcpy(w->out->data + w->out->len, w->s, len);
+	w->out->data[w->out->len + len] = '\n';
+	w->out->len += len + 1;
+}
+
+// rip_pruned.c's solve(), on the worker's private copy of the string
+void solve(t_worker *w, int i, int balance, int open_budget, int close_budget, int opens_left, int closes_left)
+{
+	char *s = w->s;
+	while (i < len && s[i] != '(' && s[i] != ')')
+		i++;
+	if (i == len)
+	{
+		emit(w);
+		return ;
+	}
+	if (s[i] == '(')
+	{
+		if (open_budget > 0)
+		{
+			s[i] = ' ';
+			solve(w, i + 1, balance, open_budget - 1, close_budget, opens_left - 1, closes_left);
+			s[i] = '(';
+		}
+		if (open_budget <= opens_left - 1)
+			solve(w, i + 1, balance + 1, open_budget, close_budget, opens_left - 1, closes_left);
+	}
+	else
+	{
+		if (close_budget > 0)
+		{
+			s[i] = ' ';
+			solve(w, i + 1, balance, open_budget, close_budget - 1, opens_left, closes_left - 1);
+			s[i] = ')';
+		}
+		if (balance > 0 && close_budget <= closes_left - 1)
+			solve(w, i + 1, balance - 1, open_budget, close_budget, opens_left, closes_left - 1);
+	}
+}
+
+void *worker_main(void *arg)
+{
+	t_worker *w = arg;
+	while (1)
+	{
+		pthread_mutex_lock(&lock);
+		int t = next_task++;
+		pthread_mutex_unlock(&lock);
+		if (t >= ntasks)
+			break ;
+		t_task *task = &tasks[t];
+		w->task = task;
+		// rebuild the string of this task from the original one
+		memcpy(w->s, input, len + 1);
+		for (int d = 0; d < split_count; d++)
+			if (task->removed & (1u << d))
+				w->s[brackets[d]] = ' ';
+		solve(w, task->i, task->balance, task->open_budget, task->close_budget,
+			task->opens_left, task->closes_left);
+		if (!unordered)
+		{
+			flush_worker(w);
+			pthread_mutex_lock(&lock);
+			task->done = 1;
+			pthread_cond_broadcast(&progress);
+			pthread_mutex_unlock(&lock);
+		}
+	}
+	flush_worker(w); // unordered mode: what is left in the private buffer
+	return NULL;
+}
+
+// ordered mode: write the tasks one after the other, as soon as their output arrives
+void write_in_order(void)
+{
+	pthread_mutex_lock(&lock);
+	for (int t = 0; t < ntasks; t++)
+	{
+		writing = t;
+		pthread_cond_broadcast(&progress);
+		while (1)
+		{
+			while (!tasks[t].head && !tasks[t].done)
+				pthread_cond_wait(&progress, &lock);
+			t_chunk *chunk = tasks[t].head;
+			int done = tasks[t].done;
+			tasks[t].head = NULL;
+			tasks[t].tail = NULL;
+			pthread_mutex_unlock(&lock);
+			int written = 0;
+			while (chunk)
+			{
+				written++;
+				t_chunk *next = chunk->next;
+				write_all(chunk->data, chunk->len);
+				free(chunk);
+				chunk = next;
+			}
+			pthread_mutex_lock(&lock);
+			buffered -= written;
+			pthread_cond_broadcast(&progress);
+			if (done && !tasks[t].head)
+				break ;
+		}
+	}
+	pthread_mutex_unlock(&lock);
+}
+
+int main(int argc, char **argv)
+{
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	int arg = 1;
+	while (arg < argc - 1)
+	{
+		if (strcmp(argv[arg], "--unordered") == 0)
+			unordered = 1;
+		else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc - 1)
+			nthreads = atoi(argv[++arg]);
+		else
+			break ;
+		arg++;
+	}
+	// error handling for incorrect arguments (same as rip.c)
+	if (arg != argc - 1)
+	{
+		write(1, "\n", 1);
+		return 0;
+	}
+	if (nthreads < 1)
+		nthreads = 1;
+	input = argv[arg];
+	len = strlen(input);
+
+	// the split: enough brackets to give every thread several tasks
+	int wanted = nthreads * TASKS_PER_THREAD;
+	for (int i = 0; i < len && split_count < MAX_SPLIT_BRACKETS && (1 << split_count) < wanted; i++)
+		if (input[i] == '(' || input[i] == ')')
+			brackets[split_count++] = i;
+	t_task root;
+	memset(&root, 0, sizeof(root));
+	for (int i = 0; i < len; i++)
+	{
+		if (input[i] == '(')
+			root.opens_left++;
+		else if (input[i] == ')')
+			root.closes_left++;
+	}
+	count_to_remove(&root.open_budget, &root.close_budget);
+	split_tasks(root, 0);
+
+	t_worker *workers = calloc(nthreads, sizeof(t_worker));
+	if (!workers || failed)
+		return 1;
+	chunk_size = (size_t)len + 1 > CHUNK_SIZE ? (size_t)len + 1 : CHUNK_SIZE;
+	max_buffered = MAX_BUFFERED_CHUNKS * nthreads;
+	for (long t = 0; t < nthreads; t++)
+	{
+		workers[t].s = malloc(len + 1);
+		workers[t].out = malloc(sizeof(t_chunk) + chunk_size);
+		if (!workers[t].s || !workers[t].out)
+		{
+			// not enough memory for this worker: run with the ones we have
+			free(workers[t].s);
+			free(workers[t].out);
+			nthreads = t;
+			break ;
+		}
+		workers[t].out->next = NULL;
+		workers[t].out->len = 0;
+		if (pthread_create(&workers[t].thread, NULL, worker_main, &workers[t]) != 0)
+		{
+			free(workers[t].s);
+			free(workers[t].out);
+			nthreads = t;
+			break ;
+		}
+	}
+	if (nthreads == 0)
+		return 1;
+	if (!unordered)
+		write_in_order();
+	for (long t = 0; t < nthreads; t++)
+	{
+		pthread_join(workers[t].thread, NULL);
+		free(workers[t].s);
+		free(workers[t].out);
+	}
+	free(workers);
+	free(tasks);
+	return failed;
+}
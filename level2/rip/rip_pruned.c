@@ -0,0 +1,111 @@
+#include <unistd.h>
+#include <stdio.h>
+#include "../../common/writer.h"
+
+/* Same output as rip.c (same solutions, same order), but without the per-leaf
+rescans: rip.c calls ft_strlen() on every recursive call and min_to_remove() on
+every leaf, and only stops a branch once it has removed too many brackets.
+
+Here everything the search needs is carried along incrementally:
+- balance: number of '(' kept so far that are still waiting for their ')'
+- open_budget / close_budget: how many '(' and ')' we still have to remove
+- opens_left / closes_left: how many '(' and ')' are still ahead of us
+
+A ')' is only kept when balance > 0, so the balance never goes negative, and a
+branch stops as soon as a budget is larger than the brackets left to spend it on.
+The invariant  balance + (opens_left - open_budget) == closes_left - close_budget
+holds on every call (it is true at the start and every move keeps it), so when
+both budgets reach 0 at the end of the string the balance is 0 as well: every
+leaf we reach is a valid solution, and there is nothing left to check there.
+This makes long inputs (several thousand characters) practical. */
+
+// the string being solved, and its length (computed once)
+char *s;
+int len;
+t_writer out; // buffered stdout: one write() for many solutions
+
+// split the unmatched brackets into '(' to remove and ')' to remove
+void count_to_remove(int *open_budget, int *close_budget)
+{
+	int open = 0, close = 0;
+	for (int i = 0; s[i]; i++)
+	{
+		if (s[i] == '(')
+			open++;
+		else if (s[i] == ')')
+		{
+			if (open > 0)
+				open--; // set off the closed bracket with an open bracket
+			else
+				close++; // this closed bracket can never be matched
+		}
+	}
+	*open_budget = open;
+	*close_budget = close;
+}
+
+void solve(int i, int balance, int open_budget, int close_budget, int opens_left, int closes_left)
+{
+	// skip the characters that are not brackets (nothing to decide there)
+	while (i < len && s[i] != '(' && s[i] != ')')
+		i++;
+	// base case: the budgets can only be 0 here, and then the balance is 0 too
+	if (i == len)
+	{
+		writer_bytes(&out, s, len); // puts(s), without looking for the '\0'
+		writer_char(&out, '\n');
+		return ;
+	}
+	if (s[i] == '(')
+	{
+		// option 1: remove it
+		if (open_budget > 0)
+		{
+			s[i] = ' ';
+			solve(i + 1, balance, open_budget - 1, close_budget, opens_left - 1, closes_left);
+			s[i] = '(';
+		}
+		// option 2: keep it (only if the '(' left after it can still pay the budget)
+		if (open_budget <= opens_left - 1)
+			solve(i + 1, balance + 1, open_budget, close_budget, opens_left - 1, closes_left);
+	}
+	else
+	{
+		// option 1: remove it
+		if (close_budget > 0)
+		{
+			s[i] = ' ';
+			solve(i + 1, balance, open_budget, close_budget - 1, opens_left, closes_left - 1);
+			s[i] = ')';
+		}
+		// option 2: keep it (never close more brackets than are open)
+		if (balance > 0 && close_budget <= closes_left - 1)
+			solve(i + 1, balance - 1, open_budget, close_budget, opens_left, closes_left - 1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	// error handling for incorrect argc
+	if (argc != 2)
+	{
+		write(1, "\n", 1);
+		return 0;
+	}
+	s = argv[1];
+	int open_budget, close_budget;
+	int opens = 0, closes = 0;
+	for (len = 0; s[len]; len++)
+	{
+		if (s[len] == '(')
+			opens++;
+		else if (s[len] == ')')
+			closes++;
+	}
+	count_to_remove(&open_budget, &close_budget);
+	// an already balanced string has empty budgets and is printed as-is
+	writer_init(&out, 1);
+	solve(0, 0, open_budget, close_budget, opens, closes);
+	writer_flush(&out);
+	return 0;
+}
@@ -7,6 +7,11 @@
 #include <sys/types.h>
 #include <float.h> // add this library for FLT_MAX
 // Remember to compile with the -lm flag!
+#ifdef FT_SCANF_LOADER
+// Coordinates read with ft_scanf instead of fscanf. Compile with:
+// gcc -DFT_SCANF_LOADER solution.c ../../level1/ft_scanf/ft_scanf_buffered.c ../../level1/ft_scanf/ft_scanf_float.c -lm
+# include "../../level1/ft_scanf/ft_scanf.h"
+#endif
 
 /* This approach to solving the Traveling Salesman Problem 
 leverages a brute-force permutation generation strategy,
@@ -172,6 +177,27 @@ ssize_t    file_size(FILE *file)
 int        retrieve_file(float (*array)[2], FILE *file)
 {
     int tmp;
+#ifdef FT_SCANF_LOADER
+	// Same loop, with the format translated once and the floats parsed by
+	// ft_scanf (same values as fscanf, much faster on big files).
+    t_scanf_prog *prog = ft_scanf_compile("%f, %f\n");
+    t_scanner *src = ft_scanner_file(file);
+    if (!prog || !src)
+    {
+        ft_scanf_free(prog);
+        return -1;
+    }
+    for (size_t i = 0; (tmp = ft_scanf_exec(prog, src, array[i] + 0, array[i] + 1)) != EOF; i++)
+        if (tmp != 2)
+        {
+            ft_scanf_free(prog);
+            ft_scanf_close(file); // forget what was read ahead
+            errno = EINVAL;
+            return -1;
+        }
+    ft_scanf_free(prog);
+    ft_scanf_close(file);
+#else
 	// Loop through the file, reading two floats per line.
     for (size_t i = 0; (tmp = fscanf(file, "%f, %f\n", array[i] + 0, array[i] + 1)) != EOF; i++)
         if (tmp != 2) // If fscanf didn't read exactly two floats, it's an error.
@@ -179,6 +205,7 @@ int        retrieve_file(float (*array)[2], FILE *file)
             errno = EINVAL;
             return -1;
         }
+#endif
 	// Check for any other file reading errors (e.g., I/O error).
     if (ferror(file))
         return -1;